@@ -0,0 +1,99 @@
+#include "network.hpp"
+
+using namespace utilsim;
+
+// Source terms of every element at their terminal DOFs
+static void gather(vector<Element*>& elems, CDM& J, int col) {
+	for (auto elem : elems) {
+		CV& j = elem->getJ();
+		for (int i = 0; i < j.numel(); i++) {
+			J(elem->getFirstDOF() + i, col) = j[i];
+		}
+	}
+}
+
+// Current balance at every conductor for solution column col, relative to the largest current there
+static double imbalance(int vdofs, vector<Element*>& elems, CDM& J, CDM& V, int col) {
+	vector<CPX> sum(vdofs, CPX(0, 0));
+	vector<double> scale(vdofs, 0);
+	for (auto elem : elems) {
+		vector<int>& nodes = elem->getNodes();
+		CDM& S = elem->getS();
+		for (int i = 0; i < (int)nodes.size(); i++) {
+			CPX cur = J(elem->getFirstDOF() + i, col);
+			for (int j = 0; j < (int)nodes.size(); j++) {
+				cur += S(i, j) * V(nodes[j], col);
+			}
+			sum[nodes[i]] += cur;
+			scale[nodes[i]] = max(scale[nodes[i]], abs(cur));
+		}
+	}
+	double err = 0;
+	for (int k = 0; k < vdofs; k++) {
+		err = max(err, abs(sum[k]) / scale[k]);
+	}
+	return err;
+}
+
+// Batch solution with distinct source terms per column against the current balance of each column
+bool batchTest() {
+	Network N = Network();
+	vector<Element*> elems;
+	vector<Junction*> J;
+	for (int k = 0; k < 4; k++) {
+		J.push_back(N.insertJunction());
+	}
+	// Feeder supplied from both ends
+	for (int k = 0; k < 2; k++) {
+		elems.push_back(N.insertElement<Source>());
+		elems.back()->connect("P", J[3 * k]);
+	}
+	vector<Element*> loads;
+	for (int k = 1; k < 4; k++) {
+		elems.push_back(N.insertElement<Line>());
+		elems.back()->connect("P", J[k - 1]);
+		elems.back()->connect("N", J[k]);
+		elems.push_back(N.insertElement<Load>());
+		elems.back()->connect("P", J[k]);
+		loads.push_back(elems.back());
+	}
+	bool ok = N.compute();
+	CV single = N.getVoltages();
+
+	// Column 0 - the network's own sources, then one load terminal injecting a different current per column
+	const int count = 4;
+	CDM sources = CDM::zeros(N.getCurrentDOFs(), count);
+	for (int s = 0; s < count; s++) {
+		gather(elems, sources, s);
+		if (s > 0) {
+			Element* load = loads[(s - 1) % loads.size()];
+			sources(load->getFirstDOF() + (s - 1) % 3, s) += CPX(50.0 * s, -20.0 * s);
+		}
+	}
+
+	CDM batch = N.compute(sources);
+	double err = 0;
+	ok = ok && batch.rows() == N.getVoltageDOFs() && batch.cols() == count;
+	for (int i = 0; ok && i < batch.rows(); i++) {
+		err = max(err, abs(batch(i, 0) - single[i]) / abs(single[i]));
+	}
+	for (int s = 0; ok && s < count; s++) {
+		err = max(err, imbalance(N.getVoltageDOFs(), elems, sources, batch, s));
+	}
+	// Injections move every column away from the base solution
+	for (int s = 1; ok && s < count; s++) {
+		double diff = 0;
+		for (int i = 0; i < batch.rows(); i++) {
+			diff = max(diff, abs(batch(i, s) - single[i]) / abs(single[i]));
+		}
+		ok = diff > 1e-6;
+	}
+	ok = ok && err < 1e-9;
+
+	// Source terms sized for another network are refused
+	CDM wrong = CDM::zeros(N.getCurrentDOFs() - 1, count);
+	ok = N.compute(wrong).numel() == 0 && ok;
+
+	cout << "batchTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
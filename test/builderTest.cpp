@@ -0,0 +1,87 @@
+#include "builder.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Bulk construction against element by element wiring of the same feeder
+bool builderTest() {
+	const int count = 6;
+	Network A = Network();
+	Builder BA = Builder(&A);
+	BA.reserve<Line>(count - 1);
+	BA.reserve(count, 3 * count);
+	int jnt = BA.insertJunctions(count);
+	int src = BA.insertElement("SOURCE");
+	int line = BA.insertElements<Line>(count - 1);
+	int load = BA.insertElements<Load>(count - 1);
+	vector<int> elems, from, to;
+	for (int k = 0; k < count - 1; k++) {
+		elems.push_back(line + k);
+		from.push_back(jnt + k);
+		to.push_back(jnt + k + 1);
+	}
+	BA.connect(&src, "P", &jnt, 1);
+	BA.connect(elems.data(), "P", from.data(), count - 1);
+	BA.connect(elems.data(), "N", to.data(), count - 1);
+	for (int k = 0; k < count - 1; k++) {
+		elems[k] = load + k;
+	}
+	BA.connect(elems.data(), "P", to.data(), count - 1);
+	// Unknown element, unknown port, junction out of range and a port listed twice,
+	// elements with an invalid link are not wired at all
+	int spare = BA.insertElements<Load>(2);
+	int half = BA.insertElements<Line>(1);
+	int bad[] = { -1, spare, spare, spare + 1, spare + 1, half, half };
+	int target[] = { jnt, jnt + 1, jnt + count, jnt + 1, jnt + 2, jnt + 1, jnt + count };
+	BA.connect(&bad[0], "P", &target[0], 1);
+	BA.connect(&bad[1], "X", &target[1], 1);
+	BA.connect(&bad[2], "P", &target[2], 1);
+	BA.connect(&bad[3], "P", &target[3], 2);
+	BA.connect(&bad[5], "P", &target[5], 1);
+	BA.connect(&bad[6], "N", &target[6], 1);
+	bool ok = BA.commit() == 7;
+	// Already connected port
+	BA.connect(&src, "P", &target[1], 1);
+	ok = BA.commit() == 1 && ok;
+	for (int k : { spare, spare + 1, half }) {
+		Element* elem = BA.getElement(k);
+		for (int p = 0; p < elem->countPorts(); p++) {
+			ok = elem->getPort(p)->Connection == nullptr && ok;
+		}
+	}
+	// Open port through the element API, left out of the calculation
+	Element* open = A.insertElement<Line>();
+	open->connect("P", BA.getJunction(jnt + 1));
+	ok = A.compute() && ok;
+	CSpan currents = A.getCurrents();
+	for (int i = 0; i < open->getCapacity(); i++) {
+		ok = currents[open->getFirstDOF() + i] == CPX(0, 0) && ok;
+	}
+
+	Network B = Network();
+	vector<Junction*> jb;
+	for (int k = 0; k < count; k++) {
+		jb.push_back(B.insertJunction());
+	}
+	Element* S1 = B.insertElement<Source>();
+	S1->connect("P", jb[0]);
+	for (int k = 1; k < count; k++) {
+		Element* L = B.insertElement<Line>();
+		L->connect("P", jb[k - 1]);
+		L->connect("N", jb[k]);
+	}
+	for (int k = 1; k < count; k++) {
+		Element* D = B.insertElement<Load>();
+		D->connect("P", jb[k]);
+	}
+	ok = B.compute() && ok;
+
+	vector<Junction*> ja;
+	for (int k = 0; k < count; k++) {
+		ja.push_back(BA.getJunction(jnt + k));
+	}
+	double err = deviation(voltages(A, ja), voltages(B, jb));
+	ok = ok && err < 1e-12;
+	cout << "builderTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,62 @@
+#include "contingency.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Ring J0 - J1 - J2 - J3 - J0 supplied at J0, loads on the others and a radial stub J3 - J4
+// Line k is left out when skip == k
+static void ring(Network& N, vector<Junction*>& J, vector<Element*>& lines, int skip) {
+	for (int k = 0; k < 5; k++) {
+		J.push_back(N.insertJunction());
+	}
+	Element* S1 = N.insertElement<Source>();
+	S1->connect("P", J[0]);
+	int ends[5][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 3, 4 } };
+	for (int k = 0; k < 5; k++) {
+		if (k == skip) {
+			continue;
+		}
+		Element* L = N.insertElement<Line>();
+		L->connect("P", J[ends[k][0]]);
+		L->connect("N", J[ends[k][1]]);
+		lines.push_back(L);
+	}
+	for (int k = 1; k < 5; k++) {
+		Element* D = N.insertElement<Load>();
+		float r = 5.0f + k;
+		D->setValue<float>("R", &r);
+		D->connect("P", J[k]);
+	}
+}
+
+// Low-rank outage updates against networks built without the line
+bool contingencyTest() {
+	Network A = Network();
+	vector<Junction*> ja;
+	vector<Element*> lines;
+	ring(A, ja, lines, -1);
+	Contingency C = Contingency(&A);
+	C.addLines();
+	bool ok = C.run(2);
+	vector<Outage>& res = C.getResults();
+	ok = ok && res.size() == lines.size();
+
+	double err = 0;
+	for (size_t k = 0; ok && k < res.size(); k++) {
+		ok = res[k].Target == lines[k];
+		// Stub outage leaves its load without a reference
+		if (k == 4) {
+			ok = ok && res[k].Islanded;
+			continue;
+		}
+		Network B = Network();
+		vector<Junction*> jb;
+		vector<Element*> lb;
+		ring(B, jb, lb, (int)k);
+		ok = ok && !res[k].Islanded && B.compute();
+		err = max(err, deviation(voltages(ja, res[k].V), voltages(B, jb)));
+	}
+	ok = ok && err < 1e-9;
+	cout << "contingencyTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef FIXTURES_HPP
+#define FIXTURES_HPP
+#include "network.hpp"
+
+// Networks and comparisons shared by the tests
+
+using namespace utilsim;
+
+// Radial feeder J[0] - J[1] - ... supplied at J[0], a line and a load with R = 5 + k towards every further junction k
+struct Feeder {
+	Element* Supply;
+	vector<Junction*> J;
+	vector<Element*> Lines;
+	vector<Element*> Loads;
+};
+
+inline Feeder feeder(Network& N, int count) {
+	Feeder F;
+	for (int k = 0; k < count; k++) {
+		F.J.push_back(N.insertJunction());
+	}
+	F.Supply = N.insertElement<Source>();
+	F.Supply->connect("P", F.J[0]);
+	for (int k = 1; k < count; k++) {
+		F.Lines.push_back(N.insertElement<Line>());
+		F.Lines.back()->connect("P", F.J[k - 1]);
+		F.Lines.back()->connect("N", F.J[k]);
+		F.Loads.push_back(N.insertElement<Load>());
+		float r = 5.0f + k;
+		F.Loads.back()->setValue<float>("R", &r);
+		F.Loads.back()->connect("P", F.J[k]);
+	}
+	return F;
+}
+
+// Conductor voltages of the junctions in their order, independent of the DOF numbering of the solution
+inline CV voltages(vector<Junction*>& J, CV& solution) {
+	int count = 0;
+	for (auto jnt : J) {
+		count += JunctionView(jnt, solution).size();
+	}
+	CV out = CV::zeros(count);
+	int k = 0;
+	for (auto jnt : J) {
+		JunctionView view = JunctionView(jnt, solution);
+		for (int i = 0; i < view.size(); i++) {
+			out[k++] = view.voltage(i);
+		}
+	}
+	return out;
+}
+
+inline CV voltages(Network& N, vector<Junction*>& J) {
+	return voltages(J, N.getVoltages());
+}
+
+// Largest deviation of a from the reference b relative to each reference entry, 1 for different sizes
+inline double deviation(const CV& a, const CV& b) {
+	double err = a.numel() == b.numel() ? 0 : 1;
+	for (int i = 0; err < 1 && i < a.numel(); i++) {
+		err = max(err, abs(a[i] - b[i]) / abs(b[i]));
+	}
+	return err;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "importer.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Escapes in skipped strings, kinds and values, nested unknown keys, one unknown kind and its link,
+// elements with an invalid link stay unwired
+static const char* Document = R"({
+	"title": "feeder {\"A\"} [1] \\",
+	"elements": [
+		{"kind": "SOURCE", "settings": {"Voltage": 10500, "Connection": "\u0059"}},
+		{"kind": "LINE", "note": "brace } quote \" slash \\", "settings": {"Length": 2.5}},
+		{"kind": "LOAD", "settings": {"R": 7.5, "X": 3}},
+		{"kind": "L\u0049NE", "settings": {"Length": 1.5}},
+		{"kind": "LOAD", "extra": {"nested": [1, {"a": "]}"}]}, "settings": {"R": 12}},
+		{"kind": "MOTOR"},
+		{"kind": "LOAD"},
+		{"kind": "LINE"}
+	],
+	"junctions": 3,
+	"connections": [
+		{"element": 0, "port": "P", "junction": 0},
+		{"element": 1, "port": "P", "junction": 0},
+		{"element": 1, "port": "N", "junction": 1},
+		{"element": 2, "port": "P", "junction": 1},
+		{"element": 3, "port": "P", "junction": 1},
+		{"element": 3, "port": "N", "junction": 2},
+		{"element": 4, "port": "P", "junction": 2},
+		{"element": 5, "port": "P", "junction": 2},
+		{"element": 6, "port": "P", "junction": 7},
+		{"element": 7, "port": "P", "junction": 2},
+		{"element": 7, "port": "Q", "junction": 2}
+	]
+}
+)";
+
+// Feeder of the given length with every record on its own line, lines of 0.5 to 2 km and loads of 5 to 15 Ohm
+static string feederDocument(int count) {
+	ostringstream doc;
+	doc << "{\n\t\"elements\": [\n\t\t{\"kind\": \"SOURCE\"}";
+	for (int k = 1; k < count; k++) {
+		doc << ",\n\t\t{\"kind\": \"LINE\", \"settings\": {\"Length\": " << 0.5 * (1 + k % 4) << "}}";
+		doc << ",\n\t\t{\"kind\": \"LOAD\", \"settings\": {\"R\": " << 5 + k % 11 << "}}";
+	}
+	doc << "\n\t],\n\t\"junctions\": " << count << ",\n\t\"connections\": [\n\t\t{\"element\": 0, \"port\": \"P\", \"junction\": 0}";
+	for (int k = 1; k < count; k++) {
+		doc << ",\n\t\t{\"element\": " << 2 * k - 1 << ", \"port\": \"P\", \"junction\": " << k - 1 << "}";
+		doc << ",\n\t\t{\"element\": " << 2 * k - 1 << ", \"port\": \"N\", \"junction\": " << k << "}";
+		doc << ",\n\t\t{\"element\": " << 2 * k << ", \"port\": \"P\", \"junction\": " << k << "}";
+	}
+	doc << "\n\t]\n}\n";
+	return doc.str();
+}
+
+// Same feeder through the builder, records in document order
+static void feederBuilder(Network* net, int count) {
+	Builder B = Builder(net);
+	int jnt = B.insertJunctions(count);
+	int src = B.insertElement("SOURCE");
+	B.connect(&src, "P", &jnt, 1);
+	for (int k = 1; k < count; k++) {
+		int line = B.insertElements<Line>(1);
+		int load = B.insertElements<Load>(1);
+		float len = 0.5f * (1 + k % 4), r = 5.0f + k % 11;
+		B.getElement(line)->setValue<float>("Length", &len);
+		B.getElement(load)->setValue<float>("R", &r);
+		int from = jnt + k - 1, to = jnt + k;
+		B.connect(&line, "P", &from, 1);
+		B.connect(&line, "N", &to, 1);
+		B.connect(&load, "P", &to, 1);
+	}
+	B.commit();
+}
+
+// Streaming import with every record split across chunks against the same network built directly
+bool importerTest() {
+	const char* path = "importerTest.json";
+	ofstream(path, ios::binary) << Document;
+
+	Network B = Network();
+	vector<Junction*> jb;
+	for (int k = 0; k < 3; k++) {
+		jb.push_back(B.insertJunction());
+	}
+	Element* S1 = B.insertElement<Source>();
+	float volts = 10500;
+	S1->setValue<float>("Voltage", &volts);
+	S1->connect("P", jb[0]);
+	float len[] = { 2.5f, 1.5f }, r[] = { 7.5f, 12.0f }, x = 3;
+	for (int k = 0; k < 2; k++) {
+		Element* L = B.insertElement<Line>();
+		L->setValue<float>("Length", &len[k]);
+		L->connect("P", jb[k]);
+		L->connect("N", jb[k + 1]);
+		Element* D = B.insertElement<Load>();
+		D->setValue<float>("R", &r[k]);
+		if (k == 0) {
+			D->setValue<float>("X", &x);
+		}
+		D->connect("P", jb[k + 1]);
+	}
+	bool ok = B.compute();
+	CV& vb = B.getVoltages();
+
+	// Chunks from a single byte up to the whole document, zero last - default size
+	double err = 0;
+	size_t size = strlen(Document);
+	vector<size_t> chunks;
+	for (size_t chunk = 1; chunk <= size; chunk = chunk < 64 ? chunk + 1 : chunk * 2) {
+		chunks.push_back(chunk);
+	}
+	chunks.push_back(0);
+	for (size_t chunk : chunks) {
+		for (int threads : { 1, 4 }) {
+			Network A = Network();
+			int rejected = buildFromJSON(&A, path, threads, chunk);
+			// Unknown kind and its connection, out of range junction, unknown port and its valid sibling
+			ok = rejected == 5 && A.compute() && ok;
+			err = max(err, deviation(A.getVoltages(), vb));
+		}
+	}
+	// Chunks holding more records than parsed on the calling thread
+	const int count = 1000;
+	string large = feederDocument(count);
+	ofstream(path, ios::binary) << large;
+	Network LB = Network();
+	feederBuilder(&LB, count);
+	ok = LB.compute() && ok;
+	for (size_t chunk : { (size_t)16384, (size_t)65536, (size_t)0 }) {
+		for (int threads : { 1, 4 }) {
+			Network A = Network();
+			ok = buildFromJSON(&A, path, threads, chunk) == 0 && A.compute() && ok;
+			err = max(err, deviation(A.getVoltages(), LB.getVoltages()));
+		}
+	}
+
+	Network M = Network();
+	ok = buildFromJSON(&M, "importerTest.missing") == -1 && ok;
+	remove(path);
+
+	ok = ok && err < 1e-12;
+	cout << "importerTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,68 @@
+#include "scenario.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Long runs of delta stamping against a network stamped once in the final state
+bool restampTest() {
+	const int count = 6, steps = 1000;
+	Network A = Network();
+	vector<Element*> la = feeder(A, count).Loads;
+	bool ok = A.compute();
+	// Near short circuits withdrawn again, every cycle leaves rounding of the large stamp behind
+	for (int s = 0; s < steps; s++) {
+		float z = (s % 2) ? 1e-9f : 5.0f + s % 7;
+		la[s % la.size()]->setValue<float>("R", &z);
+		la[s % la.size()]->setValue<float>("X", &z);
+		ok = A.compute() && ok;
+	}
+	// Ordinary edits for longer than the restamp period
+	for (int s = 0; s < 2 * steps / 10; s++) {
+		float z = 5.0f + s % 7;
+		la[s % la.size()]->setValue<float>("R", &z);
+		la[s % la.size()]->setValue<float>("X", &z);
+		ok = A.compute() && ok;
+	}
+	// Scenario of the final base, edited the same way
+	Scenario SC = Scenario(&A);
+	for (int s = 0; s < steps; s++) {
+		float z = (s % 2) ? 1e-9f : 6.0f + s % 7;
+		ok = SC.setValue<float>(la[(s + 1) % la.size()], "R", &z) && ok;
+		ok = SC.setValue<float>(la[(s + 1) % la.size()], "X", &z) && ok;
+		ok = SC.compute() && ok;
+	}
+	for (int s = 0; s < 2 * steps / 10; s++) {
+		float z = 6.0f + s % 7;
+		ok = SC.setValue<float>(la[(s + 1) % la.size()], "R", &z) && ok;
+		ok = SC.setValue<float>(la[(s + 1) % la.size()], "X", &z) && ok;
+		ok = SC.compute() && ok;
+	}
+
+	Network B = Network();
+	vector<Element*> lb = feeder(B, count).Loads;
+	for (size_t k = 0; k < lb.size(); k++) {
+		float z[2];
+		la[k]->getValue<float>("R", &z[0]);
+		la[k]->getValue<float>("X", &z[1]);
+		lb[k]->setValue<float>("R", &z[0]);
+		lb[k]->setValue<float>("X", &z[1]);
+	}
+	ok = B.compute() && ok;
+	double base = deviation(A.getVoltages(), B.getVoltages());
+
+	Network C = Network();
+	vector<Element*> lc = feeder(C, count).Loads;
+	for (size_t k = 0; k < lc.size(); k++) {
+		float z[2];
+		SC.getValue<float>(la[k], "R", &z[0]);
+		SC.getValue<float>(la[k], "X", &z[1]);
+		lc[k]->setValue<float>("R", &z[0]);
+		lc[k]->setValue<float>("X", &z[1]);
+	}
+	ok = C.compute() && ok;
+	double scenario = deviation(SC.getVoltages(), C.getVoltages());
+
+	ok = ok && base < 1e-9 && scenario < 1e-9;
+	cout << "restampTest: network deviation " << base << ", scenario deviation " << scenario << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
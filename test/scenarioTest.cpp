@@ -0,0 +1,86 @@
+#include <thread>
+#include "scenario.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Scenarios on one base against modified copies of the base network
+bool scenarioTest() {
+	const int count = 6, scenarios = 4;
+	Network A = Network();
+	vector<Element*> la = feeder(A, count).Loads;
+	bool ok = A.compute();
+	CV base = A.getVoltages();
+
+	// Each scenario edits two loads, then one of them again after a solution
+	vector<Scenario*> SC;
+	for (int s = 0; s < scenarios; s++) {
+		SC.push_back(new Scenario(&A));
+	}
+	vector<char> solved(scenarios, 0);
+	vector<thread> workers;
+	for (int s = 0; s < scenarios; s++) {
+		workers.push_back(thread([&, s]() {
+			float r1 = 1.0f + s, r2 = 20.0f + s, r3 = 0.5f + s;
+			bool done = SC[s]->setValue<float>(la[s], "R", &r1);
+			done = SC[s]->setValue<float>(la[s + 1], "R", &r2) && done;
+			done = SC[s]->compute() && done;
+			done = SC[s]->setValue<float>(la[s], "R", &r3) && done;
+			solved[s] = SC[s]->compute() && done;
+		}));
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	double err = 0;
+	for (int s = 0; s < scenarios; s++) {
+		Network B = Network();
+		vector<Element*> lb = feeder(B, count).Loads;
+		float r2 = 20.0f + s, r3 = 0.5f + s;
+		lb[s]->setValue<float>("R", &r3);
+		lb[s + 1]->setValue<float>("R", &r2);
+		ok = B.compute() && solved[s] && ok;
+		err = max(err, deviation(SC[s]->getVoltages(), B.getVoltages()));
+		ok = SC[s]->countModified() == 2 && ok;
+	}
+	// Base network and its solution are untouched
+	float r;
+	la[0]->getValue<float>("R", &r);
+	ok = ok && r == 6.0f && deviation(A.getVoltages(), base) == 0;
+	for (auto sc : SC) {
+		delete sc;
+	}
+
+	// Scenarios forked concurrently over a base with edits made after its last calculation
+	// start from their solution
+	Network C = Network();
+	vector<Element*> lc = feeder(C, count).Loads;
+	ok = C.compute() && ok;
+	float r4 = 0.5f;
+	lc[2]->setValue<float>("R", &r4);
+	vector<Scenario*> SD(scenarios, nullptr);
+	workers.clear();
+	for (int s = 0; s < scenarios; s++) {
+		workers.push_back(thread([&, s]() {
+			SD[s] = new Scenario(&C);
+			solved[s] = SD[s]->compute();
+		}));
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+	Network D = Network();
+	vector<Element*> ld = feeder(D, count).Loads;
+	ld[2]->setValue<float>("R", &r4);
+	ok = D.compute() && C.isFrozen() && ok;
+	for (int s = 0; s < scenarios; s++) {
+		ok = solved[s] && ok;
+		err = max(err, deviation(SD[s]->getVoltages(), D.getVoltages()));
+		delete SD[s];
+	}
+
+	ok = ok && err < 1e-9;
+	cout << "scenarioTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,150 @@
+#include "shortcircuit.hpp"
+
+using namespace utilsim;
+
+// Selected inverse and solve of the LDU factors against the dense inverse
+static double inverseDeviation() {
+	// Tree with a few meshes, complex and unsymmetric
+	int n = 40;
+	CSM Y = CSM(n, n);
+	CDM Yd = CDM::zeros(n, n);
+	vector<vector<int>> groups;
+	for (int k = 0; k < n; k++) {
+		Y(k, k) = CPX(4 + k % 3, -2);
+		Yd(k, k) = Y(k, k);
+		int p = k > 0 ? (k - 1) / 2 : -1;
+		int m = k % 7 == 6 ? k - 5 : -1;
+		for (int j : { p, m }) {
+			if (j < 0) {
+				continue;
+			}
+			Y(k, j) = CPX(-1, 0.5);
+			Y(j, k) = CPX(-1, 0.3 + 0.01 * k);
+			Yd(k, j) = Y(k, j);
+			Yd(j, k) = Y(j, k);
+		}
+		if (k % 4 == 0 && k + 2 < n) {
+			groups.push_back({ k, k + 1, k + 2 });
+		}
+	}
+	CSLDU ldu;
+	ldu.analyze(Y, groups);
+	if (!ldu.factorize(Y)) {
+		return 1;
+	}
+	ldu.invert();
+	CDM Zd = Yd | CDM::eye(n);
+	double err = 0;
+	for (auto& grp : groups) {
+		for (int i : grp) {
+			for (int j : grp) {
+				err = max(err, abs(ldu.inverse(i, j) - Zd(i, j)));
+			}
+		}
+	}
+	CV b = CV::zeros(n);
+	for (int k = 0; k < n; k++) {
+		b[k] = CPX(1, 0.1 * k);
+	}
+	CV x = ldu.solve(b);
+	CV r = Yd * x;
+	for (int k = 0; k < n; k++) {
+		err = max(err, abs(r[k] - b[k]));
+	}
+	return err;
+}
+
+// Impedance blocks, pre-fault voltages and fault currents against the dense inverse of the nodal matrix
+static double faultDeviation() {
+	Network N = Network();
+	vector<Junction*> J;
+	vector<Element*> elems;
+	elems.push_back(N.insertElement<Source>());
+	for (int k = 0; k < 8; k++) {
+		J.push_back(N.insertJunction());
+	}
+	elems[0]->connect("P", J[0]);
+	for (int k = 1; k < 8; k++) {
+		Element* L = N.insertElement<Line>();
+		L->connect("P", J[(k - 1) / 2]);
+		L->connect("N", J[k]);
+		Element* D = N.insertElement<Load>();
+		D->connect("P", J[k]);
+		float r = 5.0f + k;
+		D->setValue<float>("R", &r);
+		elems.push_back(L);
+		elems.push_back(D);
+	}
+	if (!N.compute()) {
+		return 1;
+	}
+
+	// Dense nodal matrix and injection from the element stamps
+	int n = N.getVoltageDOFs();
+	CDM Yd = CDM::zeros(n, n);
+	CDM Rd = CDM::zeros(n, 1);
+	for (auto elem : elems) {
+		vector<int>& nodes = elem->getNodes();
+		for (int i = 0; i < (int)nodes.size(); i++) {
+			for (int j = 0; j < (int)nodes.size(); j++) {
+				Yd(nodes[i], nodes[j]) += elem->getS()(i, j);
+			}
+			Rd(nodes[i], 0) -= elem->getJ()[i];
+		}
+	}
+	CDM Zd = Yd | CDM::eye(n);
+	CDM Vd = Zd * Rd;
+
+	ShortCircuit sc = ShortCircuit(&N);
+	CPX zf = CPX(0.5, 0.2);
+	sc.setImpedance(zf);
+	if (!sc.run() || sc.getResults().size() != J.size()) {
+		return 1;
+	}
+	double err = 0;
+	for (auto& f : sc.getResults()) {
+		int first = f.Target->getFirstDOF();
+		int k = f.ThreePhase.numel();
+		if (f.Singular || f.Impedance.rows() != k || k == 0) {
+			return 1;
+		}
+		CDM Zb = CDM(k, k);
+		CDM Vb = CDM(k, 1);
+		for (int i = 0; i < k; i++) {
+			for (int j = 0; j < k; j++) {
+				err = max(err, abs(f.Impedance(i, j) - Zd(first + i, first + j)) / abs(Zd(first + i, first + i)));
+				Zb(i, j) = Zd(first + i, first + j);
+			}
+			Zb(i, i) += zf;
+			Vb(i, 0) = Vd(first + i, 0);
+			CPX single = Vb(i, 0) / Zb(i, i);
+			err = max(err, abs(f.SingleLine[i] - single) / abs(single));
+		}
+		CDM I = Zb | Vb;
+		for (int i = 0; i < k; i++) {
+			err = max(err, abs(f.ThreePhase[i] - I(i, 0)) / abs(I(i, 0)));
+		}
+	}
+	return err;
+}
+
+// Rank deficient up to rounding, the pivot has to be rejected
+static bool singularRejected() {
+	CSM Y = CSM(2, 2);
+	Y(0, 0) = CPX(1, 0.1);
+	Y(0, 1) = CPX(3, 0.3);
+	Y(1, 0) = CPX(1.0 / 3, 0.1 / 3);
+	Y(1, 1) = CPX(1, 0.1);
+	CSLDU ldu;
+	ldu.analyze(Y);
+	return !ldu.factorize(Y);
+}
+
+bool shortCircuitTest() {
+	double inv = inverseDeviation();
+	double flt = faultDeviation();
+	bool singular = singularRejected();
+	bool ok = inv < 1e-12 && flt < 1e-9 && singular;
+	cout << "shortCircuitTest: inverse deviation " << inv << ", fault deviation " << flt << (singular ? ", singular rejected" : ", singular accepted") << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include "snapshot.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Save and load round trip at non-default frequencies
+bool snapshotTest() {
+	Network A = Network();
+	vector<Junction*> J;
+	for (int k = 0; k < 4; k++) {
+		J.push_back(A.insertJunction());
+	}
+	Element* S1 = A.insertElement<Source>();
+	S1->connect("P", J[0]);
+	for (int k = 1; k < 4; k++) {
+		Element* L = A.insertElement<Line>();
+		L->connect("P", J[k - 1]);
+		L->connect("N", J[k]);
+		Element* D = A.insertElement<Load>();
+		float x = 2.0f * k;
+		D->setValue<float>("X", &x);
+		D->connect("P", J[k]);
+	}
+	// Fifth harmonic of a 60 Hz system
+	A.setRatedFrequency(60);
+	A.setFrequency(300);
+	bool ok = A.compute();
+
+	const char* path = "snapshotTest.usim";
+	ok = Snapshot::save(&A, path) && ok;
+	Network B = Network();
+	ok = Snapshot::load(&B, path) && ok;
+	remove(path);
+	ok = ok && B.getFrequency() == 300 && B.getRatedFrequency() == 60;
+	ok = B.compute() && ok;
+
+	double err = deviation(B.getVoltages(), A.getVoltages());
+	ok = ok && err < 1e-12;
+	cout << "snapshotTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,58 @@
+#include "sweep.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Feeder with inductive loads, network frequency at its rated value
+static vector<Junction*> inductive(Network& N, int count) {
+	Feeder F = feeder(N, count);
+	for (size_t k = 0; k < F.Loads.size(); k++) {
+		float x = 2.0f * (k + 1);
+		F.Loads[k]->setValue<float>("X", &x);
+	}
+	return F.J;
+}
+
+// Pipelined sweep against independent solutions at every frequency
+bool sweepTest() {
+	const int count = 5;
+	Network A = Network();
+	vector<Junction*> ja = inductive(A, count);
+	double base = A.getFrequency();
+	Sweep SW = Sweep(&A);
+	SW.addFrequencies(base, 13 * base, 7);
+	SW.addFrequency(0.5 * base);
+	SW.setSources(Emf::ALL);
+	SW.run(3);
+	vector<CV>& res = SW.getResults();
+	bool ok = res.size() == 8 && A.getFrequency() == base;
+	// Points are distinct solutions
+	ok = ok && res[0].numel() > 0 && abs(res[0][res[0].numel() - 1] - res[1][res[1].numel() - 1]) > 1e-6 * abs(res[0][res[0].numel() - 1]);
+
+	double err = 0;
+	for (size_t p = 0; ok && p < res.size(); p++) {
+		Network B = Network();
+		vector<Junction*> jb = inductive(B, count);
+		B.setFrequency(SW.getFrequencies()[p]);
+		ok = B.compute();
+		err = max(err, deviation(voltages(ja, res[p]), voltages(B, jb)));
+	}
+	// By default the emfs drive the fundamental point only, the harmonic point has nothing to solve for
+	Sweep SD = Sweep(&A);
+	SD.addFrequency(base);
+	SD.addFrequency(5 * base);
+	SD.run(2);
+	ok = ok && SD.getResults().size() == 2 && deviation(SD.getResults()[0], res[0]) < 1e-12;
+	for (int i = 0; ok && i < SD.getResults()[1].numel(); i++) {
+		ok = SD.getResults()[1][i] == CPX(0, 0);
+	}
+	// Network is left at its own frequency
+	ok = ok && A.compute();
+	Network C = Network();
+	vector<Junction*> jc = inductive(C, count);
+	ok = ok && C.compute();
+	err = max(err, deviation(voltages(A, ja), voltages(C, jc)));
+	ok = ok && err < 1e-9;
+	cout << "sweepTest: relative deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
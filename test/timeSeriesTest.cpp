@@ -0,0 +1,56 @@
+#include "timeseries.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Keeps every solved step
+class RecordSink : public Sink {
+public:
+	vector<CV> Steps;
+	void write(int, CV& voltages) {
+		Steps.push_back(voltages);
+	}
+};
+
+// Column profiles against the same values written element by element
+bool timeSeriesTest() {
+	const int count = 5, steps = 4;
+	Network A = Network();
+	Feeder FA = feeder(A, count);
+	vector<float> profile;
+	for (int s = 0; s < steps; s++) {
+		for (int k = 1; k < count; k++) {
+			profile.push_back(5.0f + k + 2.0f * s);
+		}
+	}
+	TimeSeries TS = TimeSeries(&A);
+	bool ok = TS.addColumn<Load>("R", profile);
+	// Vector, enum settings and unknown names are refused
+	ok = !TS.addChannel(FA.Supply, "ZN", vector<float>(steps, 1.0f)) && ok;
+	ok = !TS.addChannel(FA.Supply, "Connection", vector<float>(steps, 1.0f)) && ok;
+	ok = !TS.addColumn<Load>("Z", profile) && ok;
+	ok = !TS.addColumn<Load>("Missing", profile) && ok;
+	RecordSink sink;
+	ok = TS.run(&sink) && ok;
+	ok = (int)sink.Steps.size() == steps && ok;
+
+	Network B = Network();
+	vector<Element*> loads = feeder(B, count).Loads;
+	double err = 0;
+	for (int s = 0; s < steps && ok; s++) {
+		for (size_t k = 0; k < loads.size(); k++) {
+			loads[k]->setValue<float>("R", &profile[s * loads.size() + k]);
+		}
+		ok = B.compute() && ok;
+		err = max(err, deviation(sink.Steps[s], B.getVoltages()));
+	}
+	ok = ok && err < 1e-9;
+
+	// A load added after the profile was set would shift the column
+	Element* D = A.insertElement<Load>();
+	D->connect("P", FA.J[1]);
+	ok = !TS.run(&sink) && ok;
+
+	cout << "timeSeriesTest: deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
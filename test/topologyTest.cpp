@@ -0,0 +1,53 @@
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Incremental renumbering of an edited network against a network built in its final state
+bool topologyTest() {
+	// Stub line and load on an extra junction, both moved away later
+	Network A = Network();
+	vector<Junction*> ja = feeder(A, 8).J;
+	Junction* stub = A.insertJunction();
+	Element* LS = A.insertElement<Line>();
+	LS->connect("P", ja[7]);
+	LS->connect("N", stub);
+	Element* LX = A.insertElement<Load>();
+	LX->connect("P", stub);
+	bool ok = A.compute();
+
+	// Port moves, the emptied junction leaves spare DOFs behind
+	LX->connect("P", ja[3]);
+	LS->connect("N", ja[4]);
+	ok = A.compute() && ok;
+	int dofs = A.getVoltageDOFs();
+
+	Network B = Network();
+	vector<Junction*> jb = feeder(B, 8).J;
+	B.insertJunction();
+	Element* MS = B.insertElement<Line>();
+	MS->connect("P", jb[7]);
+	MS->connect("N", jb[4]);
+	Element* MX = B.insertElement<Load>();
+	MX->connect("P", jb[3]);
+	ok = B.compute() && ok;
+	double moved = deviation(voltages(A, ja), voltages(B, jb));
+	// Numbering was kept, the abandoned block is decoupled
+	ok = ok && dofs == B.getVoltageDOFs() + 3;
+
+	// Growth after the moves, new blocks are appended
+	for (Network* N : { &A, &B }) {
+		vector<Junction*>& J = N == &A ? ja : jb;
+		J.push_back(N->insertJunction());
+		Element* L = N->insertElement<Line>();
+		L->connect("P", J[5]);
+		L->connect("N", J.back());
+		Element* D = N->insertElement<Load>();
+		D->connect("P", J.back());
+		ok = N->compute() && ok;
+	}
+	double grown = deviation(voltages(A, ja), voltages(B, jb));
+
+	ok = ok && moved < 1e-9 && grown < 1e-9;
+	cout << "topologyTest: moved deviation " << moved << ", grown deviation " << grown << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,95 @@
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Feeder J0..J4 with a stub line J4 - J5 and a fifth load at its end
+struct Stubbed {
+	Network N;
+	vector<Junction*> J;
+	vector<Element*> Loads;
+	Element* Stub;
+	Stubbed() {
+		Feeder F = feeder(N, 5);
+		J = F.J;
+		Loads = F.Loads;
+		J.push_back(N.insertJunction());
+		Stub = N.insertElement<Line>();
+		Stub->connect("P", J[4]);
+		Stub->connect("N", J[5]);
+		Loads.push_back(N.insertElement<Load>());
+		float r = 10;
+		Loads.back()->setValue<float>("R", &r);
+		Loads.back()->connect("P", J[5]);
+	}
+};
+
+// Rollback restores settings and wiring, commit matches a network built in the final state
+bool transactionTest() {
+	Stubbed A;
+	bool ok = A.N.compute();
+	CV before = voltages(A.N, A.J);
+
+	// Settings, bulk column and switching, all discarded
+	A.N.begin();
+	float r = 3;
+	A.Loads[0]->setValue<float>("R", &r);
+	vector<float> column = { 7, 8, 9, 10, 11 };
+	A.N.setValues<Load>(A.N.getKey<Load>("X"), column.data());
+	A.Loads[1]->connect("P", A.J[4]);
+	A.Loads[3]->connect("P", A.J[1]);
+	A.N.rollback();
+	float value = 0;
+	A.Loads[0]->getValue<float>("R", &value);
+	bool restored = value == 6;
+	A.Loads[2]->getValue<float>("X", &value);
+	restored = restored && value == 10;
+	restored = restored && A.Loads[1]->getPort(0)->Connection == A.J[2] && A.Loads[3]->getPort(0)->Connection == A.J[4];
+	ok = A.N.compute() && ok;
+	double rolled = deviation(voltages(A.N, A.J), before);
+
+	// Scripted switching, the last connection of a port wins and ports leave their old junctions
+	A.N.begin();
+	A.Loads[0]->setValue<float>("R", &r);
+	A.Loads[1]->connect("P", A.J[3]);
+	A.Loads[1]->connect("P", A.J[4]);
+	A.Loads[3]->connect("P", A.J[1]);
+	// Stub junction is left without ports
+	A.Loads[4]->connect("P", A.J[2]);
+	A.Stub->connect("N", A.J[3]);
+	ok = A.N.compute() && ok;
+	// Second switching on top of the committed one
+	A.N.begin();
+	A.Loads[2]->connect("P", A.J[1]);
+	A.N.commit();
+	ok = A.N.compute() && ok;
+
+	Network B = Network();
+	vector<Junction*> jb;
+	Element* S1 = B.insertElement<Source>();
+	jb.push_back(B.insertJunction());
+	S1->connect("P", jb[0]);
+	int target[] = { 1, 4, 1, 1, 2 };
+	for (int k = 1; k < 5; k++) {
+		jb.push_back(B.insertJunction());
+		Element* L = B.insertElement<Line>();
+		L->connect("P", jb[k - 1]);
+		L->connect("N", jb[k]);
+	}
+	jb.push_back(B.insertJunction());
+	Element* stub = B.insertElement<Line>();
+	stub->connect("P", jb[4]);
+	stub->connect("N", jb[3]);
+	for (int k = 0; k < 5; k++) {
+		Element* D = B.insertElement<Load>();
+		float rk = k == 0 ? r : 6.0f + k;
+		D->setValue<float>("R", &rk);
+		D->connect("P", jb[target[k]]);
+	}
+	ok = B.compute() && ok;
+	double committed = deviation(voltages(A.N, A.J), voltages(B, jb));
+
+	ok = ok && restored && rolled == 0 && committed < 1e-9;
+	cout << "transactionTest: rollback " << (restored ? "restored" : "NOT restored") << " deviation " << rolled
+		<< ", commit deviation " << committed << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
@@ -0,0 +1,98 @@
+#include "transient.hpp"
+#include "fixtures.hpp"
+
+using namespace utilsim;
+
+// Fundamental phasor of the last cycle, v(t) = Re(V exp(jwt))
+struct PhasorFit : Sink {
+	double W, Dt;
+	int First, Samples;
+	vector<CPX> Acc;
+	void write(int step, CV& v) {
+		if (step < First) {
+			return;
+		}
+		double t = (step + 1) * Dt;
+		if (Acc.empty()) {
+			Acc.assign(v.numel(), CPX(0, 0));
+		}
+		for (int k = 0; k < v.numel(); k++) {
+			Acc[k] += v[k].real() * exp(CPX(0, -W * t)) * (2.0 / Samples);
+		}
+	}
+	// Fitted phasors of the network DOFs, internal nodes are left out
+	CV phasors(int count) {
+		CV out = CV::zeros(count);
+		for (int k = 0; k < count && k < (int)Acc.size(); k++) {
+			out[k] = Acc[k];
+		}
+		return out;
+	}
+};
+
+
+// Steady state of the EMT solution against the phasor load flow, before and after a load change
+bool transientTest() {
+	Network N = Network();
+	Element* S1 = N.insertElement<Source>();
+	Element* L1 = N.insertElement<Line>();
+	Element* LD1 = N.insertElement<Load>();
+	Junction* J1 = N.insertJunction();
+	Junction* J2 = N.insertJunction();
+	S1->connect("P", J1);
+	L1->connect("P", J1);
+	L1->connect("N", J2);
+	LD1->connect("P", J2);
+	N.compute();
+	CV phasor = N.getVoltages();
+
+	// Twenty cycles to settle, the last one is fitted
+	Transient T = Transient(&N);
+	double dt = 1e-5;
+	PhasorFit fit;
+	fit.W = 2 * 3.1415 * N.getFrequency();
+	fit.Dt = dt;
+	fit.Samples = (int)round(1 / (N.getFrequency() * dt));
+	fit.First = 20 * fit.Samples;
+	if (!T.setStep(dt) || !T.run(21 * fit.Samples, &fit)) {
+		cout << "transientTest: step rejected FAILED" << endl;
+		return false;
+	}
+	double err = deviation(fit.phasors(phasor.numel()), phasor);
+
+	// Parametric change, branches are rebuilt by the next run with their states kept
+	float r = 20;
+	LD1->setValue<float>("R", &r);
+	N.compute();
+	phasor = N.getVoltages();
+	fit.Acc.clear();
+	fit.First = 41 * fit.Samples;
+	T.run(21 * fit.Samples, &fit);
+	err = max(err, deviation(fit.phasors(phasor.numel()), phasor));
+
+	// Step size change refactorizes on the kept pattern, restarted so the fit keeps its time base
+	T.reset();
+	fit.Dt = dt / 2;
+	fit.Samples = 2 * fit.Samples;
+	fit.Acc.clear();
+	fit.First = 20 * fit.Samples;
+	if (!T.setStep(dt / 2) || !T.run(21 * fit.Samples, &fit)) {
+		cout << "transientTest: halved step rejected FAILED" << endl;
+		return false;
+	}
+	err = max(err, deviation(fit.phasors(phasor.numel()), phasor));
+
+	// Structural change, new pattern and a de-energized restart
+	Element* LD2 = N.insertElement<Load>();
+	LD2->connect("P", J2);
+	N.compute();
+	phasor = N.getVoltages();
+	fit.Acc.clear();
+	fit.First = 41 * fit.Samples;
+	T.run(21 * fit.Samples, &fit);
+	err = max(err, deviation(fit.phasors(phasor.numel()), phasor));
+
+	bool ok = err < 1e-3;
+	cout << "transientTest: relative steady state deviation " << err << (ok ? " passed" : " FAILED") << endl;
+	return ok;
+}
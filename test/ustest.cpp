@@ -1,17 +1,41 @@
-#include "network.hpp"
+#include "importer.hpp"
 using namespace utilsim;
 
+#include <chrono>
+
 //#include "loadSDN.cpp"
-//#include <chrono>
-//using namespace utilsim;
 
 //#include <fstream>
 //#include <nlohmann/json.hpp>
 //using json = nlohmann::json;
-void buildFromJSON(Network* N);
 void setTest();
-void tic();
-double toc();
+bool loadFlowTest();
+bool transientTest();
+bool shortCircuitTest();
+bool topologyTest();
+bool transactionTest();
+bool timeSeriesTest();
+bool batchTest();
+bool snapshotTest();
+bool modelCacheTest();
+bool scenarioTest();
+bool restampTest();
+bool contingencyTest();
+bool builderTest();
+bool importerTest();
+bool sweepTest();
+
+static std::chrono::steady_clock::time_point ticTime;
+
+void tic()
+{
+	ticTime = std::chrono::steady_clock::now();
+}
+
+double toc()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ticTime).count();
+}
 
 int main()
 {
@@ -31,8 +55,22 @@ int main()
 
 	tic();
 	N.compute();
-	cout << "Calcultaion took: " << toc() << "ms";
+	cout << "Calcultaion took: " << toc() << "ms" << endl;
 
-	
-	return 0;
+	bool ok = loadFlowTest();
+	ok = transientTest() && ok;
+	ok = shortCircuitTest() && ok;
+	ok = topologyTest() && ok;
+	ok = transactionTest() && ok;
+	ok = timeSeriesTest() && ok;
+	ok = batchTest() && ok;
+	ok = snapshotTest() && ok;
+	ok = modelCacheTest() && ok;
+	ok = scenarioTest() && ok;
+	ok = restampTest() && ok;
+	ok = contingencyTest() && ok;
+	ok = builderTest() && ok;
+	ok = importerTest() && ok;
+	ok = sweepTest() && ok;
+	return ok ? 0 : 1;
 }
\ No newline at end of file
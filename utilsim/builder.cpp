@@ -0,0 +1,110 @@
+#include <algorithm>
+#include "builder.hpp"
+
+namespace utilsim
+{
+	Builder::Builder(Network* net) : Net(net) {
+
+	}
+
+	void Builder::reserve(int junctions, int links) {
+		Net->reserve(junctions);
+		Junctions.reserve(Junctions.size() + junctions);
+		Links.reserve(Links.size() + links);
+	}
+
+	int Builder::insertElement(const char* kind) {
+		Element* elem = Net->insertElement(kind);
+		if (elem == nullptr) {
+			return -1;
+		}
+		Elements.push_back(elem);
+		return (int)Elements.size() - 1;
+	}
+
+	int Builder::insertJunctions(int count) {
+		int first = (int)Junctions.size();
+		for (int k = 0; k < count; k++) {
+			Junctions.push_back(Net->insertJunction());
+		}
+		return first;
+	}
+
+	void Builder::connect(const int* elements, const char* port, const int* junctions, int count) {
+		// Recording only, ports are resolved per element since kinds may differ
+		for (int k = 0; k < count; k++) {
+			int pidx = -1;
+			if (elements[k] >= 0 && elements[k] < (int)Elements.size()) {
+				pidx = Elements[elements[k]]->findPort(port);
+			}
+			Links.push_back({ elements[k], pidx, junctions[k] });
+		}
+	}
+
+	int Builder::commit() {
+		int rejected = 0;
+		// Consistency checks, an element with any invalid link is left unwired
+		vector<char> refused(Elements.size(), 0);
+		vector<Link> valid;
+		valid.reserve(Links.size());
+		for (auto& lnk : Links) {
+			if (lnk.Elem < 0 || lnk.Elem >= (int)Elements.size()) {
+				rejected++;
+				continue;
+			}
+			if (lnk.Prt < 0 || lnk.Jnt < 0 || lnk.Jnt >= (int)Junctions.size() ||
+				Elements[lnk.Elem]->getPort(lnk.Prt)->Connection != nullptr) {
+				refused[lnk.Elem] = 1;
+			}
+			valid.push_back(lnk);
+		}
+		// Port listed twice
+		stable_sort(valid.begin(), valid.end(), [](const Link& a, const Link& b) {
+			return a.Elem < b.Elem || (a.Elem == b.Elem && a.Prt < b.Prt);
+		});
+		for (size_t k = 1; k < valid.size(); k++) {
+			if (valid[k].Elem == valid[k - 1].Elem && valid[k].Prt == valid[k - 1].Prt) {
+				refused[valid[k].Elem] = 1;
+			}
+		}
+		// All links of refused elements are dropped, open ports never reach the junctions
+		size_t kept = 0;
+		for (auto& lnk : valid) {
+			if (refused[lnk.Elem]) {
+				rejected++;
+			}
+			else {
+				valid[kept++] = lnk;
+			}
+		}
+		valid.resize(kept);
+		// Grouping by junction
+		stable_sort(valid.begin(), valid.end(), [](const Link& a, const Link& b) {
+			return a.Jnt < b.Jnt;
+		});
+		// Single wiring pass per junction
+		vector<Port*> ports;
+		for (size_t first = 0; first < valid.size();) {
+			size_t last = first;
+			Junction* jnt = Junctions[valid[first].Jnt];
+			ports.clear();
+			for (; last < valid.size() && valid[last].Jnt == valid[first].Jnt; last++) {
+				Port* prt = Elements[valid[last].Elem]->getPort(valid[last].Prt);
+				prt->Connection = jnt;
+				ports.push_back(prt);
+			}
+			jnt->connectPorts(ports.data(), (int)ports.size());
+			first = last;
+		}
+		Links.clear();
+		return rejected;
+	}
+
+	Element* Builder::getElement(int idx) {
+		return Elements[idx];
+	}
+
+	Junction* Builder::getJunction(int idx) {
+		return Junctions[idx];
+	}
+}
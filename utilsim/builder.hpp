@@ -0,0 +1,51 @@
+#ifndef BUILDER_HPP
+#define BUILDER_HPP
+#include "network.hpp"
+
+// Bulk network construction with deferred wiring
+
+namespace utilsim
+{
+	class Builder {
+	public:
+		Builder(Network* net);
+		// Capacity hints
+		template<class T> void reserve(int count) {
+			Net->reserve<T>(count);
+			Elements.reserve(Elements.size() + count);
+		}
+		void reserve(int junctions, int links);
+		// Creation, returns builder index of the first new object
+		template<class T> int insertElements(int count) {
+			int first = (int)Elements.size();
+			for (int k = 0; k < count; k++) {
+				Elements.push_back(Net->insertElement<T>());
+			}
+			return first;
+		}
+		// By settings kind name, -1 for unknown kinds
+		int insertElement(const char* kind);
+		int insertJunctions(int count);
+		// Connection list, port of elements[k] goes to junctions[k] (builder indices)
+		void connect(const int* elements, const char* port, const int* junctions, int count);
+		// Validation and conductor creation in one pass, returns number of rejected connections
+		// Links of an element are applied all or none, an element with an invalid link stays unwired
+		// and is left out of the calculation
+		int commit();
+		// Access by builder index
+		Element* getElement(int idx);
+		Junction* getJunction(int idx);
+	private:
+		struct Link {
+			int Elem;
+			int Prt;
+			int Jnt;
+		};
+		Network* Net;
+		vector<Element*> Elements;
+		vector<Junction*> Junctions;
+		vector<Link> Links;
+	};
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "contingency.hpp"
+#include <thread>
+#include <atomic>
+
+namespace utilsim
+{
+	Contingency::Contingency(Network* net) {
+		Net = net;
+	}
+
+	void Contingency::addOutage(Element* target) {
+		Results.push_back({ target, false, CV(0) });
+	}
+
+	void Contingency::addLines() {
+		for (auto elem : Net->Elements) {
+			if (dynamic_cast<Line*>(elem) != nullptr) {
+				addOutage(elem);
+			}
+		}
+	}
+
+	vector<Outage>& Contingency::getResults() {
+		return Results;
+	}
+
+	bool Contingency::run(int threads) {
+		// Base case, factorization is shared read-only by all workers
+		if (!Net->compute()) {
+			return false;
+		}
+
+		if (threads <= 0) {
+			threads = max(1, (int)thread::hardware_concurrency());
+		}
+		threads = min(threads, (int)Results.size());
+
+		// Dynamic distribution over the pool
+		atomic<int> next(0);
+		auto worker = [&]() {
+			for (int k = next++; k < (int)Results.size(); k = next++) {
+				solve(Results[k]);
+			}
+		};
+		vector<thread> pool;
+		for (int t = 1; t < threads; t++) {
+			pool.push_back(thread(worker));
+		}
+		worker();
+		for (auto& th : pool) {
+			th.join();
+		}
+		return true;
+	}
+
+	void Contingency::solve(Outage& out) {
+		vector<int>& nodes = out.Target->getNodes();
+		CDM& S = out.Target->getS();
+		CV& J = out.Target->getJ();
+		int k = (int)nodes.size();
+		if (k == 0) {
+			// Element out of the calculation, its outage changes nothing
+			out.Islanded = false;
+			out.V = Net->V;
+			return;
+		}
+		vector<int> local(k);
+		for (int i = 0; i < k; i++) {
+			local[i] = i;
+		}
+
+		// Outaged element columns
+		CDM E = CDM::zeros(Net->VDOFS, k);
+		for (int i = 0; i < k; i++) {
+			E(nodes[i], i) += CPX(1, 0);
+		}
+		CDM Z = Net->Solver.solve(E);
+
+		// Base solution without element injection
+		CV x = Net->V + Z * J;
+		CV xn = CV(k);
+		for (int i = 0; i < k; i++) {
+			xn[i] = x[nodes[i]];
+		}
+
+		// Capacitance-like correction matrix
+		CDM M = CDM::eye(k) - Z(nodes, local) * S;
+		if (M.rank(1e-9) < k) {
+			out.Islanded = true;
+			out.V = CV(0);
+			return;
+		}
+		out.Islanded = false;
+		out.V = x + Z * ((S * (CDM::eye(k) / M)) * xn);
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef CONTINGENCY_HPP
+#define CONTINGENCY_HPP
+#include "network.hpp"
+
+// N-1 contingency analysis
+
+namespace utilsim
+{
+	// Single element outage result
+	struct Outage {
+		Element* Target;
+		// Outage splits the network, no unique solution
+		bool Islanded;
+		CV V;
+	};
+
+	class Contingency {
+		/*	Element removal as a low-rank update of the base factorization
+			Y' = Y - E*S*E'
+			V' = x + Z*S*(I - E'*Z*S)^-1 * E'*x
+			where:
+			E - element terminals to conductors incidence
+			Z - Y^-1 * E
+			x - base solution without element source term, V - Z*J
+		*/
+	public:
+		Contingency(Network* net);
+		void addOutage(Element* target);
+		// Every Line of the network
+		void addLines();
+		// Zero threads - hardware concurrency, false on a singular base network
+		bool run(int threads = 0);
+		vector<Outage>& getResults();
+	private:
+		Network* Net;
+		vector<Outage> Results;
+		void solve(Outage& out);
+	};
+}
+
+#endif
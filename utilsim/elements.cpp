@@ -1,4 +1,5 @@
 #include "elements.hpp"
+#include "kernels.hpp"
 using namespace std::complex_literals;
 using namespace std;
 
@@ -8,6 +9,8 @@ namespace utilsim {
 	
 	// Settings DB
 	SettingsData Source::SD = Source::getData();
+	SettingKey Source::ConnectionKey = Source::SD.getKey("Connection");
+	int Source::ConnectionYN = Source::SD.encodeEnum("Connection", "YN");
 
 	SettingsData Source::getData() {
 		SettingsData sd = SettingsData("SOURCE");
@@ -29,37 +32,96 @@ namespace utilsim {
 
 	// Construction
 	Source::Source(NID* parent) : Element(parent, {"P"}, & SD) {
-		// Configure ports
+		// Configure ports and stamp buffers
 		updateTopology();
 	}
 
+	Element* Source::clone() {
+		return new Source(*this);
+	}
+
 	void Source::updateTopology() {
-		int conCode = 0;		
-		SDR->getValue<int>(SET, "Connection", &conCode);
-		if (SDR->decodeEnum("Connection", conCode) == "YN") {
+		int conCode = 0;
+		getValue<int>(ConnectionKey, &conCode);
+		if (conCode == ConnectionYN) {
 			configurePort("P", { "A", "B", "C", "N" });
 		}
 		else {
 			configurePort("P", { "A", "B", "C" });
 		}
+		// Stamp buffers written in place by the batch kernels, one row per terminal
+		int n = (int)getPort(0)->Terminals.size();
+		if (S.rows() != n) {
+			S = CDM(n, n);
+			J = CV::zeros(n);
+		}
 	}
 
+	// Balanced source phasors A B C
+	static const CPX SourceV[] = { exp(0.0), exp(2.0 * 3.1415 * 2i / 3.0), exp(2.0 * 3.1415 * 1i / 3.0) };
+
 	void Source::updateModel() {
-		// Presentation update
-		CDM B = CDM::ones(3, 3);
-		CDM rho = CDM::eye(3) * CPX(0.1, 0.1);
-		CDM alp = (B / rho) * (CPX(1, 0) / ((CDM::ones(1, 3) / rho) * CDM::ones(3, 1))(0, 0));
-		CV V = CV(3);
-		V << exp(0.0), exp(2.0 * 3.1415 * 2i / 3.0), exp(2.0 * 3.1415 * 1i / 3.0);
-		// A B C
-		S = rho | (alp - CDM::eye(3));
-		J = (rho | (CDM::eye(3) - alp)) * V;
+		// Single instance through the batch path
+		updateBatch({ this });
+	}
+
+	int Source::branches(vector<Branch>& out) {
+		// Emf behind R-L per phase, star point is the neutral terminal or an internal node
+		double r = 0.1, l = 0.1 / (2.0 * 3.1415 * ratedFrequency());
+		int star = getPort(0)->Terminals.size() > 3 ? 3 : -2;
+		for (int k = 0; k < 3; k++) {
+			out.push_back({ star, k, r, l, 0, SourceV[k] });
+		}
+		return star == -2 ? 1 : 0;
+	}
+
+	thread_local vector<double> Source::BatchR, Source::BatchX;
+	thread_local vector<CPX*> Source::BatchS, Source::BatchJ;
+
+	void Source::updateBatch(const vector<Element*>& items) {
+		// Gathering of modified instances, presentation update with inductive reactance
+		vector<double>& r = BatchR;
+		vector<double>& x = BatchX;
+		vector<CPX*>& s = BatchS;
+		vector<CPX*>& j = BatchJ;
+		// Floating star first, then sources grounded through their neutral terminal
+		for (int neutral = 0; neutral < 2; neutral++) {
+			r.clear();
+			x.clear();
+			s.clear();
+			j.clear();
+			for (auto item : items) {
+				Source* elem = static_cast<Source*>(item);
+				if ((elem->S.rows() == 4) != (neutral == 1)) {
+					continue;
+				}
+				r.push_back(0.1);
+				x.push_back(0.1 * elem->harmonic());
+				s.push_back(elem->S.data());
+				j.push_back(elem->J.data());
+			}
+			if (neutral == 0) {
+				sourceKernel((int)r.size(), r.data(), x.data(), SourceV, s.data(), j.data());
+			}
+			else {
+				neutralSourceKernel((int)r.size(), r.data(), x.data(), SourceV, s.data(), j.data());
+			}
+		}
+	}
+
+	template<> void Pool<Source>::update(const vector<Element*>& modified) {
+		Source::updateBatch(modified);
 	}
 
 	// LINE ==============================================================
 
 	SettingsData Line::SD = Line::getData();
 	SettingsData Line::LSD = Line::getLibData();
+	Record Line::Standard(Line::LSD.getInstance(), &Line::LSD);
+	SettingKey Line::LengthKey = Line::SD.getKey("Length");
+	SettingKey Line::RKey = Line::LSD.getKey("R");
+	SettingKey Line::LKey = Line::LSD.getKey("L");
+	SettingKey Line::CKey = Line::LSD.getKey("C");
 
 	SettingsData Line::getData() {
 		SettingsData sd = SettingsData("LINE");
@@ -68,6 +130,9 @@ namespace utilsim {
 		sd.insertSetting<float>("Y", size, false, &defaultFloat);
 		vector<const char*> vals = { "A","B","C" };
 		sd.insertEnumSetting("Z", size, false, vals, "A");
+		// km
+		defaultFloat = 2.5;
+		sd.insertSetting<float>("Length", size, false, &defaultFloat);
 		return sd;
 	}
 
@@ -78,6 +143,13 @@ namespace utilsim {
 		lsd.insertSetting<float>("Y", size, false, &defaultFloat);
 		vector<const char*> vals = { "A","B","C" };
 		lsd.insertEnumSetting("Z", size, false, vals, "A");
+		// Per km parameters - Ohm, H, F
+		defaultFloat = 0.4f;
+		lsd.insertSetting<float>("R", size, false, &defaultFloat);
+		defaultFloat = 1e-3f;
+		lsd.insertSetting<float>("L", size, false, &defaultFloat);
+		defaultFloat = 1e-7f;
+		lsd.insertSetting<float>("C", size, false, &defaultFloat);
 		return lsd;
 	}
 
@@ -86,6 +158,14 @@ namespace utilsim {
 		updateTopology();
 	}
 
+	Element* Line::clone() {
+		return new Line(*this);
+	}
+
+	shared_ptr<vector<CDM>> Line::getModel() {
+		return Modal;
+	}
+
 	void Line::updateTopology() {
 		// TBD - ports configure depending on library setting
 		configurePort("P", { "A", "B", "C" });
@@ -93,35 +173,105 @@ namespace utilsim {
 	}
 
 	void Line::updateModel() {
-		CDM W = CDM(6, 6);
-		CPX w = CPX(2.0 * 3.1415 * 50.0, 0);
-		W << 0.0, 0.0, 0.0, 0.4 + w * 1e-3 * 1i, 0.0, 0.0,
-			0.0, 0.0, 0.0, 0.0, 0.4 + w * 1e-3 * 1i, 0.0,
-			0.0, 0.0, 0.0, 0.0, 0.0, 0.4 + w * 1e-3 * 1i,
-			w * 1e-7 * 1i, 0.0, 0.0, 0.0, 0.0, 0.0,
-			0.0, w * 1e-7 * 1i, 0.0, 0.0, 0.0, 0.0,
-			0.0, 0.0, w * 1e-7 * 1i, 0.0, 0.0, 0.0;
+		Record* type = (Lib != nullptr) ? Lib : &Standard;
+		CPX w = CPX(2.0 * 3.1415 * frequency(), 0);
+		float length = *SD.at<float>(SET, LengthKey);
+
+		// Modal decomposition is shared by all lines of the type
+		ModelKey key = { w.real() };
+		Modal = type->findModel(key);
+		if (Modal == nullptr) {
+			SettingsData* lib = type->getSettings();
+			float r = *lib->at<float>(type->getInstance(), RKey);
+			float l = *lib->at<float>(type->getInstance(), LKey);
+			float c = *lib->at<float>(type->getInstance(), CKey);
+			CPX z = (double)r + w * (double)l * 1i;
+			CPX y = w * (double)c * 1i;
+
+			CDM W = CDM(6, 6);
+			W << 0.0, 0.0, 0.0, z, 0.0, 0.0,
+				0.0, 0.0, 0.0, 0.0, z, 0.0,
+				0.0, 0.0, 0.0, 0.0, 0.0, z,
+				y, 0.0, 0.0, 0.0, 0.0, 0.0,
+				0.0, y, 0.0, 0.0, 0.0, 0.0,
+				0.0, 0.0, y, 0.0, 0.0, 0.0;
+
+			CDM P = CDM(6, 6);
+			CV d = CV(6);
+			W.eig(P, d);
+			if (P.rank(1e-9) < 6) {
+				// Defective (e.g. no shunt) - matrix exponential per line
+				Modal = type->storeModel(key, { W });
+			}
+			else {
+				CDM D = CDM(6, 1);
+				for (int k = 0; k < 6; k++) {
+					D(k, 0) = d[k];
+				}
+				Modal = type->storeModel(key, { P, CDM::eye(6) / P, D });
+			}
+		}
 
-		CDM X = expm(W * CPX(-2.5, 0.0));
+		// expm(-length * W)
+		CFM<6, 6> X;
+		if (Modal->size() == 1) {
+			X = CFM<6, 6>(expm((*Modal)[0] * CPX(-length, 0.0)));
+		}
+		else {
+			// P * diag(exp(-length * d)) * P^-1
+			CFM<6, 6> P = CFM<6, 6>((*Modal)[0]);
+			for (int k = 0; k < 6; k++) {
+				CPX e = exp(-(double)length * (*Modal)[2](k, 0));
+				for (int i = 0; i < 6; i++) {
+					P(i, k) *= e;
+				}
+			}
+			X = P * CFM<6, 6>((*Modal)[1]);
+		}
 
-		CDM X1 = X({ 0,1,2 }, { 0,1,2 });
-		CDM X2 = X({ 0,1,2 }, { 3,4,5 });
-		CDM X3 = X({ 3,4,5 }, { 0,1,2 });
-		CDM X4 = X({ 3,4,5 }, { 3,4,5 });
+		CFM<3, 3> X1 = X.block<3, 3>(0, 0);
+		CFM<3, 3> X2 = X.block<3, 3>(0, 3);
+		CFM<3, 3> X3 = X.block<3, 3>(3, 0);
+		CFM<3, 3> X4 = X.block<3, 3>(3, 3);
 
-		CDM x1 = ((X2 | X1) * CPX(-1, 0));
-		CDM x2 = CDM::eye(3) / X2;
-		CDM x3 = X3 * CPX(-1, 0) + X4 / X2 * X1;
-		CDM x4 = X4 / X2 * CPX(-1, 0);
+		// X2 is factored once for all divisions
+		CFLU<3> F = CFLU<3>(X2);
+		CFM<3, 3> x1 = (F | X1) * CPX(-1, 0);
+		CFM<3, 3> x2 = F.inverse();
+		CFM<3, 3> x4 = X4 / F * CPX(-1, 0);
+		CFM<3, 3> x3 = X3 * CPX(-1, 0) - x4 * X1;
 
-		S = CDM(6, 6);
-		S << x1, x2, x3, x4;
-		J = CV::zeros(6);
+		CFM<6, 6> s;
+		s << x1, x2, x3, x4;
+		S.set(s);
+		J.set(CFM<6, 1>::zeros());
+	}
+
+	int Line::branches(vector<Branch>& out) {
+		// Nominal pi-section per phase, terminals P A B C then N A B C
+		Record* type = (Lib != nullptr) ? Lib : &Standard;
+		SettingsData* lib = type->getSettings();
+		float length = *SD.at<float>(SET, LengthKey);
+		float r = *lib->at<float>(type->getInstance(), RKey);
+		float l = *lib->at<float>(type->getInstance(), LKey);
+		float c = *lib->at<float>(type->getInstance(), CKey);
+		for (int k = 0; k < 3; k++) {
+			out.push_back({ k, 3 + k, (double)r * length, (double)l * length, 0, 0.0 });
+			if ((double)c * length <= 0) {
+				// Short line without shunt, a zero capacitance has no companion
+				continue;
+			}
+			out.push_back({ k, Branch::Ground, 0, 0, (double)c * length / 2, 0.0 });
+			out.push_back({ 3 + k, Branch::Ground, 0, 0, (double)c * length / 2, 0.0 });
+		}
+		return 0;
 	}
 
 	// LOAD ==============================================================
 
 	SettingsData Load::SD = getData();
+	SettingKey Load::RKey = Load::SD.getKey("R");
+	SettingKey Load::XKey = Load::SD.getKey("X");
 
 	SettingsData Load::getData() {
 		SettingsData sd = SettingsData("LOAD");
@@ -130,25 +280,66 @@ namespace utilsim {
 		sd.insertSetting<float>("Y", size, false, &defaultFloat);
 		vector<const char*> vals = { "A","B","C" };
 		sd.insertEnumSetting("Z", size, false, vals, "A");
+		// Delta impedance per phase pair
+		defaultFloat = 10;
+		sd.insertSetting<float>("R", size, false, &defaultFloat);
+		sd.insertSetting<float>("X", size, false, &defaultFloat);
 		return sd;
 	}
 
 	Load::Load(NID* parent) : Element(parent, {"P"}, &SD) {
+		// Stamp buffers written in place by the batch kernels
+		S = CDM(3, 3);
+		J = CV::zeros(3);
 		// Configure ports
 		updateTopology();
 	}
 
+	Element* Load::clone() {
+		return new Load(*this);
+	}
+
 	void Load::updateTopology() {
 		// TBD
 		configurePort("P", { "A", "B", "C" });
 	}
 
 	void Load::updateModel() {
-		S = CDM(3, 3);
-		CPX Z = CPX(10.0, 10.0);
-		S << 2.0 / Z, -1.0 / Z, -1.0 / Z,
-			-1.0 / Z, 2.0 / Z, -1.0 / Z,
-			-1.0 / Z, -1.0 / Z, 2.0 / Z;
-		J = CV::zeros(3);
+		// Single instance through the batch path
+		updateBatch({ this });
+	}
+
+	int Load::branches(vector<Branch>& out) {
+		// Delta connected R-L per phase pair
+		double r = *SD.at<float>(SET, RKey);
+		double l = *SD.at<float>(SET, XKey) / (2.0 * 3.1415 * ratedFrequency());
+		for (int k = 0; k < 3; k++) {
+			out.push_back({ k, (k + 1) % 3, r, l, 0, 0.0 });
+		}
+		return 0;
+	}
+
+	thread_local vector<double> Load::BatchR, Load::BatchX;
+	thread_local vector<CPX*> Load::BatchS;
+
+	void Load::updateBatch(const vector<Element*>& items) {
+		// Gathering of modified instances, impedances straight from the settings columns
+		vector<double>& r = BatchR;
+		vector<double>& x = BatchX;
+		vector<CPX*>& s = BatchS;
+		r.clear();
+		x.clear();
+		s.clear();
+		for (auto item : items) {
+			Load* elem = static_cast<Load*>(item);
+			r.push_back(*SD.at<float>(elem->SET, RKey));
+			x.push_back(*SD.at<float>(elem->SET, XKey) * elem->harmonic());
+			s.push_back(elem->S.data());
+		}
+		loadKernel((int)r.size(), r.data(), x.data(), s.data());
+	}
+
+	template<> void Pool<Load>::update(const vector<Element*>& modified) {
+		Load::updateBatch(modified);
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define ELEMENTS_HPP
 
 #include "topology.hpp"
+#include "pool.hpp"
 
 // Power system elements models
 
@@ -12,11 +13,21 @@ namespace utilsim {
 		// Settings DB
 		static SettingsData SD;
 		static SettingsData getData();
+		// Resolved settings
+		static SettingKey ConnectionKey;
+		static int ConnectionYN;
 		// Calculation interface
 		void updateModel();
 		void updateTopology();
+		static void updateBatch(const vector<Element*>& items);
+		// Gather buffers reused by the batches of the calling thread
+		static thread_local vector<double> BatchR, BatchX;
+		static thread_local vector<CPX*> BatchS, BatchJ;
+		friend class Pool<Source>;
 	public:
 		Source(NID* parent);
+		Element* clone();
+		int branches(vector<Branch>& out);
 	};
 
 	class Line : public Element
@@ -26,12 +37,23 @@ namespace utilsim {
 		static SettingsData SD;
 		static SettingsData getData();		
 		static SettingsData getLibData();
+		// Resolved settings
+		static SettingKey LengthKey;
+		static SettingKey RKey, LKey, CKey;
 		// Calculation interface
 		void updateModel();
 		void updateTopology();
+		friend class Pool<Line>;
+		// Default type for lines without library record
+		static Record Standard;
+		// Modal data held from the type cache, shared by the lines of one type and frequency
+		shared_ptr<vector<CDM>> Modal;
 	public:
 		static SettingsData LSD;
 		Line(NID* parent);
+		Element* clone();
+		shared_ptr<vector<CDM>> getModel();
+		int branches(vector<Branch>& out);
 	};
 
 	class Load : public Element
@@ -40,11 +62,24 @@ namespace utilsim {
 		// Settings DB
 		static SettingsData SD;
 		static SettingsData getData();
+		// Resolved settings
+		static SettingKey RKey, XKey;
 		// Calculation interface
 		void updateModel();
 		void updateTopology();
+		static void updateBatch(const vector<Element*>& items);
+		// Gather buffers reused by the batches of the calling thread
+		static thread_local vector<double> BatchR, BatchX;
+		static thread_local vector<CPX*> BatchS;
+		friend class Pool<Load>;
 	public:
 		Load(NID* parent);
+		Element* clone();
+		int branches(vector<Branch>& out);
 	};
+
+	// Batched model evaluation of the simple elements
+	template<> void Pool<Source>::update(const vector<Element*>& modified);
+	template<> void Pool<Load>::update(const vector<Element*>& modified);
 }
 #endif
\ No newline at end of file
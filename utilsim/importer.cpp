@@ -0,0 +1,437 @@
+#include <fstream>
+#include <thread>
+#include <cctype>
+#include "importer.hpp"
+
+namespace utilsim
+{
+	// Default bytes read per pass, records crossing the boundary are carried over
+	static const size_t ChunkBytes = 1 << 25;
+	// Below this many records a chunk is parsed on the calling thread
+	static const size_t ParallelRecords = 256;
+
+	enum class Section { NONE, ELEMENTS, JUNCTIONS, CONNECTIONS };
+
+	struct Span {
+		const char* Begin;
+		const char* End;
+	};
+
+	// Parsed records
+	struct ElementRecord {
+		bool Valid = false;
+		string Kind;
+		vector<pair<string, vector<string>>> Settings;
+	};
+
+	struct LinkRecord {
+		bool Valid = false;
+		int Element = -1;
+		string Port;
+		int Junction = -1;
+	};
+
+	// SCANNER ===========================================================
+	// Tracks nesting and strings only, records are the objects directly inside the top-level arrays
+
+	class Scanner {
+	public:
+		// Returns start of an unfinished record, size if the chunk was consumed completely
+		size_t scan(const char* buf, size_t size, vector<Span>& elements, vector<Span>& links, int& junctions) {
+			size_t start = size;
+			for (size_t i = 0; i < size; i++) {
+				char c = buf[i];
+				if (InString) {
+					if (Escape) {
+						Escape = false;
+					}
+					else if (c == '\\') {
+						Escape = true;
+						continue;
+					}
+					else if (c == '"') {
+						InString = false;
+						continue;
+					}
+					if (KeyString) {
+						Key += c;
+					}
+					continue;
+				}
+				switch (c) {
+				case '"':
+					InString = true;
+					KeyString = Depth == 1 && ExpectKey;
+					if (KeyString) {
+						Key.clear();
+					}
+					break;
+				case '{':
+				case '[':
+					Depth++;
+					if (Depth == 1) {
+						ExpectKey = true;
+					}
+					else if (Depth == 3 && c == '{' && (Current == Section::ELEMENTS || Current == Section::CONNECTIONS)) {
+						start = i;
+					}
+					break;
+				case '}':
+				case ']':
+					if (Depth == 3 && start < size) {
+						(Current == Section::ELEMENTS ? elements : links).push_back({ buf + start, buf + i + 1 });
+						start = size;
+					}
+					if (Depth == 1) {
+						finish(junctions);
+					}
+					Depth--;
+					break;
+				case ':':
+					if (Depth == 1) {
+						ExpectKey = false;
+						Current = Key == "elements" ? Section::ELEMENTS : Key == "junctions" ? Section::JUNCTIONS :
+							Key == "connections" ? Section::CONNECTIONS : Section::NONE;
+					}
+					break;
+				case ',':
+					if (Depth == 1) {
+						finish(junctions);
+						ExpectKey = true;
+					}
+					break;
+				default:
+					if (Depth == 1 && Current == Section::JUNCTIONS && !isspace((unsigned char)c)) {
+						Number += c;
+					}
+				}
+			}
+			if (start < size) {
+				// Record is rescanned from its opening brace with the next chunk
+				Depth = 2;
+				InString = false;
+				Escape = false;
+			}
+			return start;
+		}
+	private:
+		void finish(int& junctions) {
+			if (Current == Section::JUNCTIONS && !Number.empty()) {
+				junctions = atoi(Number.c_str());
+			}
+			Number.clear();
+			Current = Section::NONE;
+		}
+		int Depth = 0;
+		bool InString = false;
+		bool Escape = false;
+		bool ExpectKey = false;
+		bool KeyString = false;
+		string Key;
+		string Number;
+		Section Current = Section::NONE;
+	};
+
+	// LEXER =============================================================
+	// Pull tokenizer over a single record
+
+	class Lexer {
+	public:
+		Lexer(Span span) : P(span.Begin), End(span.End) {}
+		bool accept(char c) {
+			skip();
+			if (P < End && *P == c) {
+				P++;
+				return true;
+			}
+			return false;
+		}
+		char peek() {
+			skip();
+			return P < End ? *P : '\0';
+		}
+		bool text(string& out) {
+			out.clear();
+			if (!accept('"')) {
+				return false;
+			}
+			while (P < End && *P != '"') {
+				char c = *P++;
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (P == End) {
+					return false;
+				}
+				c = *P++;
+				switch (c) {
+				case 'n': out += '\n'; break;
+				case 't': out += '\t'; break;
+				case 'r': out += '\r'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'u': {
+					// Basic plane only, encoded as UTF-8
+					if (End - P < 4) {
+						return false;
+					}
+					unsigned code = (unsigned)strtoul(string(P, 4).c_str(), nullptr, 16);
+					P += 4;
+					if (code < 0x80) {
+						out += (char)code;
+					}
+					else if (code < 0x800) {
+						out += (char)(0xC0 | (code >> 6));
+						out += (char)(0x80 | (code & 0x3F));
+					}
+					else {
+						out += (char)(0xE0 | (code >> 12));
+						out += (char)(0x80 | ((code >> 6) & 0x3F));
+						out += (char)(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default: out += c;
+				}
+			}
+			return accept('"');
+		}
+		bool scalar(string& out) {
+			skip();
+			const char* begin = P;
+			while (P < End && !isspace((unsigned char)*P) && *P != ',' && *P != '}' && *P != ']') {
+				P++;
+			}
+			out.assign(begin, P);
+			return P > begin;
+		}
+		// Setting value, single token or flat array
+		bool value(vector<string>& out) {
+			out.clear();
+			if (!accept('[')) {
+				out.emplace_back();
+				return peek() == '"' ? text(out.back()) : scalar(out.back());
+			}
+			if (accept(']')) {
+				return true;
+			}
+			do {
+				out.emplace_back();
+				if (!(peek() == '"' ? text(out.back()) : scalar(out.back()))) {
+					return false;
+				}
+			} while (accept(','));
+			return accept(']');
+		}
+		bool skipValue() {
+			string tmp;
+			char c = peek();
+			if (c == '"') {
+				return text(tmp);
+			}
+			if (c != '{' && c != '[') {
+				return scalar(tmp);
+			}
+			// Nested structure, strings may contain brackets
+			int depth = 0;
+			do {
+				c = peek();
+				if (c == '"') {
+					if (!text(tmp)) {
+						return false;
+					}
+					continue;
+				}
+				if (P == End) {
+					return false;
+				}
+				depth += (c == '{' || c == '[') - (c == '}' || c == ']');
+				P++;
+			} while (depth > 0);
+			return true;
+		}
+	private:
+		void skip() {
+			while (P < End && isspace((unsigned char)*P)) {
+				P++;
+			}
+		}
+		const char* P;
+		const char* End;
+	};
+
+	// RECORDS ===========================================================
+
+	static void parseElement(Span span, ElementRecord& rec) {
+		Lexer in(span);
+		rec = ElementRecord();
+		string key;
+		if (!in.accept('{') || in.accept('}')) {
+			return;
+		}
+		do {
+			if (!in.text(key) || !in.accept(':')) {
+				return;
+			}
+			if (key == "kind") {
+				if (!in.text(rec.Kind)) {
+					return;
+				}
+			}
+			else if (key == "settings") {
+				if (!in.accept('{')) {
+					return;
+				}
+				if (in.accept('}')) {
+					continue;
+				}
+				do {
+					rec.Settings.emplace_back();
+					if (!in.text(rec.Settings.back().first) || !in.accept(':') || !in.value(rec.Settings.back().second)) {
+						return;
+					}
+				} while (in.accept(','));
+				if (!in.accept('}')) {
+					return;
+				}
+			}
+			else if (!in.skipValue()) {
+				return;
+			}
+		} while (in.accept(','));
+		rec.Valid = in.accept('}') && !rec.Kind.empty();
+	}
+
+	static void parseLink(Span span, LinkRecord& rec) {
+		Lexer in(span);
+		rec = LinkRecord();
+		string key, val;
+		if (!in.accept('{') || in.accept('}')) {
+			return;
+		}
+		do {
+			if (!in.text(key) || !in.accept(':')) {
+				return;
+			}
+			if (key == "element" || key == "junction") {
+				if (!in.scalar(val)) {
+					return;
+				}
+				(key == "element" ? rec.Element : rec.Junction) = atoi(val.c_str());
+			}
+			else if (key == "port") {
+				if (!in.text(rec.Port)) {
+					return;
+				}
+			}
+			else if (!in.skipValue()) {
+				return;
+			}
+		} while (in.accept(','));
+		rec.Valid = in.accept('}') && !rec.Port.empty();
+	}
+
+	// IMPORT ============================================================
+
+	int buildFromJSON(Network* net, const char* path, int threads, size_t chunk) {
+		ifstream file(path, ios::binary);
+		if (!file) {
+			return -1;
+		}
+		if (threads <= 0) {
+			threads = max(1, (int)thread::hardware_concurrency());
+		}
+		if (chunk == 0) {
+			chunk = ChunkBytes;
+		}
+
+		Builder build(net);
+		Scanner scanner;
+		vector<char> buffer;
+		vector<Span> elemSpans, linkSpans;
+		vector<ElementRecord> elems;
+		vector<LinkRecord> links;
+		// Position in the file to builder index
+		vector<int> elemIndex;
+		vector<char> value;
+		int junctions = 0;
+		int created = 0;
+		int rejected = 0;
+		size_t carry = 0;
+		bool last = false;
+		while (!last) {
+			// Next chunk behind the carried-over record
+			buffer.resize(carry + chunk);
+			file.read(buffer.data() + carry, chunk);
+			size_t size = carry + (size_t)file.gcount();
+			last = !file;
+			elemSpans.clear();
+			linkSpans.clear();
+			size_t rest = scanner.scan(buffer.data(), size, elemSpans, linkSpans, junctions);
+
+			// Parallel parsing of complete records, contiguous slices per thread
+			elems.resize(elemSpans.size());
+			links.resize(linkSpans.size());
+			size_t total = elemSpans.size() + linkSpans.size();
+			auto worker = [&](size_t first, size_t count) {
+				for (size_t k = first; k < first + count; k++) {
+					if (k < elemSpans.size()) {
+						parseElement(elemSpans[k], elems[k]);
+					}
+					else {
+						parseLink(linkSpans[k - elemSpans.size()], links[k - elemSpans.size()]);
+					}
+				}
+			};
+			int workers = total < ParallelRecords ? 1 : threads;
+			size_t slice = (total + workers - 1) / workers;
+			vector<thread> pool;
+			for (int t = 1; t < workers && t * slice < total; t++) {
+				pool.push_back(thread(worker, t * slice, min(slice, total - t * slice)));
+			}
+			worker(0, min(slice, total));
+			for (auto& th : pool) {
+				th.join();
+			}
+
+			// Elements in file order, settings through the kind schema
+			for (auto& rec : elems) {
+				int idx = rec.Valid ? build.insertElement(rec.Kind.c_str()) : -1;
+				elemIndex.push_back(idx);
+				if (idx < 0) {
+					rejected++;
+					continue;
+				}
+				Element* elem = build.getElement(idx);
+				for (auto& set : rec.Settings) {
+					SettingKey key = elem->getKey(set.first.c_str());
+					value.resize(key.Bytes);
+					if (!elem->getSettings()->parseValue(key, set.second, value.data())) {
+						rejected++;
+						continue;
+					}
+					elem->setValue<char>(key, value.data());
+				}
+			}
+			if (junctions > created) {
+				build.insertJunctions(junctions - created);
+				created = junctions;
+			}
+			// Connections are validated together at commit, a malformed record refuses the element it names
+			for (auto& rec : links) {
+				int elem = (rec.Element >= 0 && rec.Element < (int)elemIndex.size()) ? elemIndex[rec.Element] : -1;
+				build.connect(&elem, rec.Valid ? rec.Port.c_str() : "", &rec.Junction, 1);
+			}
+
+			// Unfinished record moves to the front
+			carry = size - rest;
+			memmove(buffer.data(), buffer.data() + rest, carry);
+		}
+		// Truncated record at the end of file
+		if (carry > 0) {
+			rejected++;
+		}
+		return rejected + build.commit();
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef IMPORTER_HPP
+#define IMPORTER_HPP
+#include "builder.hpp"
+
+// Streaming JSON network import
+/*	Expected document, sections in this order:
+	{
+		"elements": [ {"kind": "LINE", "settings": {"Length": 2.5, "ZN": [1e6, 1e6]}}, ... ],
+		"junctions": 2,
+		"connections": [ {"element": 1, "port": "P", "junction": 0}, ... ]
+	}
+	Kinds, settings and enum values are resolved through the element settings schema,
+	elements and junctions are referenced by position. Unknown top-level keys are skipped.
+	An element with a rejected connection is kept unwired and left out of the calculation.
+	The file is read in chunks, complete records of a chunk are parsed on several threads
+	and applied in file order, no document tree is built.
+*/
+
+namespace utilsim
+{
+	// Returns number of rejected records or settings, -1 if the file cannot be read
+	// Zero chunk - 32 MiB read per pass
+	int buildFromJSON(Network* net, const char* path, int threads = 0, size_t chunk = 0);
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include "kernels.hpp"
+// Vector paths are compiled for their target and selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86
+#define KERNELS_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define KERNELS_X86
+#define KERNELS_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace utilsim {
+
+	// Instances processed per pass - keeps scratch on the stack
+	static const int Chunk = 64;
+
+	// Complex reciprocal y = 1 / (re + j*im), vectorized over instances
+	typedef void (*ReciprocalFn)(int n, const double* re, const double* im, double* yr, double* yi);
+
+	static void reciprocalScalar(int n, const double* re, const double* im, double* yr, double* yi) {
+		for (int k = 0; k < n; k++) {
+			double d = re[k] * re[k] + im[k] * im[k];
+			yr[k] = re[k] / d;
+			yi[k] = -im[k] / d;
+		}
+	}
+
+#if defined(KERNELS_X86)
+	KERNELS_TARGET("avx512f")
+	static void reciprocalAVX512(int n, const double* re, const double* im, double* yr, double* yi) {
+		int k = 0;
+		for (; k + 8 <= n; k += 8) {
+			__m512d a = _mm512_loadu_pd(re + k);
+			__m512d b = _mm512_loadu_pd(im + k);
+			__m512d d = _mm512_add_pd(_mm512_mul_pd(a, a), _mm512_mul_pd(b, b));
+			_mm512_storeu_pd(yr + k, _mm512_div_pd(a, d));
+			_mm512_storeu_pd(yi + k, _mm512_div_pd(_mm512_sub_pd(_mm512_setzero_pd(), b), d));
+		}
+		// Scalar tail
+		reciprocalScalar(n - k, re + k, im + k, yr + k, yi + k);
+	}
+
+	KERNELS_TARGET("avx2,fma")
+	static void reciprocalAVX2(int n, const double* re, const double* im, double* yr, double* yi) {
+		int k = 0;
+		for (; k + 4 <= n; k += 4) {
+			__m256d a = _mm256_loadu_pd(re + k);
+			__m256d b = _mm256_loadu_pd(im + k);
+			__m256d d = _mm256_fmadd_pd(a, a, _mm256_mul_pd(b, b));
+			_mm256_storeu_pd(yr + k, _mm256_div_pd(a, d));
+			_mm256_storeu_pd(yi + k, _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), b), d));
+		}
+		// Scalar tail
+		reciprocalScalar(n - k, re + k, im + k, yr + k, yi + k);
+	}
+#endif
+
+	// Widest path supported by the CPU and the OS register state
+	static ReciprocalFn selectReciprocal() {
+#if defined(KERNELS_X86) && defined(__GNUC__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			return reciprocalAVX512;
+		}
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return reciprocalAVX2;
+		}
+#elif defined(KERNELS_X86)
+		int info[4];
+		__cpuid(info, 0);
+		int ids = info[0];
+		__cpuid(info, 1);
+		bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+		bool fma = (info[2] & (1 << 12)) != 0;
+		unsigned long long xcr = avx ? _xgetbv(0) : 0;
+		if (avx && (xcr & 0x06) == 0x06 && ids >= 7) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 16)) && (xcr & 0xE6) == 0xE6) {
+				return reciprocalAVX512;
+			}
+			if ((info[1] & (1 << 5)) && fma) {
+				return reciprocalAVX2;
+			}
+		}
+#endif
+		return reciprocalScalar;
+	}
+
+	static void reciprocal(int n, const double* re, const double* im, double* yr, double* yi) {
+		static const ReciprocalFn Dispatch = selectReciprocal();
+		Dispatch(n, re, im, yr, yi);
+	}
+
+	// Symmetric 3x3 stamp with equal diagonal and off-diagonal terms
+	static inline void stamp(CPX* s, CPX diag, CPX off) {
+		s[0] = diag; s[1] = off;  s[2] = off;
+		s[3] = off;  s[4] = diag; s[5] = off;
+		s[6] = off;  s[7] = off;  s[8] = diag;
+	}
+
+	void loadKernel(int n, const double* r, const double* x, CPX* const* S) {
+		double yr[Chunk], yi[Chunk];
+		for (int base = 0; base < n; base += Chunk) {
+			int m = std::min(Chunk, n - base);
+			reciprocal(m, r + base, x + base, yr, yi);
+			for (int k = 0; k < m; k++) {
+				CPX y(yr[k], yi[k]);
+				stamp(S[base + k], 2.0 * y, -y);
+			}
+		}
+	}
+
+	void sourceKernel(int n, const double* r, const double* x, const CPX* V, CPX* const* S, CPX* const* J) {
+		// Zero-sequence free part of the source voltages is shared by all instances
+		CPX v0 = (V[0] + V[1] + V[2]) / 3.0;
+		CPX w[] = { V[0] - v0, V[1] - v0, V[2] - v0 };
+		double yr[Chunk], yi[Chunk];
+		for (int base = 0; base < n; base += Chunk) {
+			int m = std::min(Chunk, n - base);
+			reciprocal(m, r + base, x + base, yr, yi);
+			for (int k = 0; k < m; k++) {
+				CPX y(yr[k], yi[k]);
+				stamp(S[base + k], y * (2.0 / 3.0), -y / 3.0);
+				CPX* j = J[base + k];
+				j[0] = -y * w[0];
+				j[1] = -y * w[1];
+				j[2] = -y * w[2];
+			}
+		}
+	}
+
+	void neutralSourceKernel(int n, const double* r, const double* x, const CPX* V, CPX* const* S, CPX* const* J) {
+		CPX sum = V[0] + V[1] + V[2];
+		double yr[Chunk], yi[Chunk];
+		for (int base = 0; base < n; base += Chunk) {
+			int m = std::min(Chunk, n - base);
+			reciprocal(m, r + base, x + base, yr, yi);
+			for (int k = 0; k < m; k++) {
+				CPX y(yr[k], yi[k]);
+				// Column-major 4x4, phases first
+				CPX* s = S[base + k];
+				for (int i = 0; i < 16; i++) {
+					s[i] = 0;
+				}
+				for (int p = 0; p < 3; p++) {
+					s[p + 4 * p] = y;
+					s[p + 12] = -y;
+					s[3 + 4 * p] = -y;
+				}
+				s[15] = 3.0 * y;
+				CPX* j = J[base + k];
+				j[0] = -y * V[0];
+				j[1] = -y * V[1];
+				j[2] = -y * V[2];
+				j[3] = y * sum;
+			}
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+#include "linalg.hpp"
+
+// Batched model evaluation of simple three-phase elements
+// Inputs are structure-of-arrays gathered over the modified members of a kind,
+// single instances go through the same batches. Outputs are written to the
+// column-major 3x3 stamp and 3x1 source buffers of each instance,
+// which delta stamping withdraws from the nodal values on the next change
+
+namespace utilsim
+{
+	// Delta connected load: S = (3I - B) / (r + jx)
+	void loadKernel(int n, const double* r, const double* x, CPX* const* S);
+	// Source behind equal phase impedances, floating star: S = (I - B/3) / (r + jx), J = -(I - B/3) V / (r + jx)
+	void sourceKernel(int n, const double* r, const double* x, const CPX* V, CPX* const* S, CPX* const* J);
+	// Source with its star point at the fourth (neutral) terminal, 4x4 stamp and 4x1 source buffers:
+	// S = [I, -1; -1', 3] / (r + jx), J = [-V; sum(V)] / (r + jx)
+	void neutralSourceKernel(int n, const double* r, const double* x, const CPX* V, CPX* const* S, CPX* const* J);
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include "linalg.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <unsupported/Eigen/MatrixFunctions>
 
 namespace utilsim {
@@ -22,6 +25,22 @@ namespace utilsim {
 		return V(i);
 	}
 
+	CPX CV::operator[](int i) const {
+		return V(i);
+	}
+
+	CV CV::operator+(const CV& adder) {
+		CV val = CV(0);
+		val.V = V + adder.V;
+		return val;
+	}
+
+	CV CV::operator-(const CV& deduct) {
+		CV val = CV(0);
+		val.V = V - deduct.V;
+		return val;
+	}
+
 	void CV::print() {
 		std::cout << V << std::endl << std::endl;
 	}
@@ -32,10 +51,18 @@ namespace utilsim {
 		return val;
 	}
 
-	int CV::numel() {
+	int CV::numel() const {
 		return (int)V.size();
 	}
 
+	CPX* CV::data() {
+		return V.data();
+	}
+
+	void CV::setZero() {
+		V.setZero();
+	}
+
 	// Complex double dense matrix
 	CDM::CDM(int rows, int cols) {
 		// Internal object initialization
@@ -50,11 +77,25 @@ namespace utilsim {
 		return (int)(M.rows() * M.cols());
 	}
 
-	int CDM::rows() {
+	int CDM::rank(double tolerance) {
+		FullPivLU<MatrixXcd> lu(M);
+		if (tolerance > 0) {
+			lu.setThreshold(tolerance);
+		}
+		return (int)lu.rank();
+	}
+
+	void CDM::eig(CDM& vectors, CV& values) {
+		ComplexEigenSolver<MatrixXcd> solver(M);
+		vectors.M = solver.eigenvectors();
+		values.V = solver.eigenvalues();
+	}
+
+	int CDM::rows() const {
 		return (int)M.rows();
 	}
 
-	int CDM::cols() {
+	int CDM::cols() const {
 		return (int)M.cols();
 	}
 
@@ -62,6 +103,10 @@ namespace utilsim {
 		return M(i, j);
 	}
 
+	CPX CDM::operator()(int i, int j) const {
+		return M(i, j);
+	}
+
 	CDM CDM::operator()(std::vector<int> rows, std::vector<int> cols) {
 		CDM RES = CDM((int)rows.size(), (int)cols.size());
 		for (int k = 0; k < (int)rows.size(); k++) {
@@ -72,6 +117,20 @@ namespace utilsim {
 		return RES;
 	}
 
+	CV CDM::col(int j) {
+		CV val = CV(rows());
+		val.V = M.col(j);
+		return val;
+	}
+
+	void CDM::setCol(int j, CV& val) {
+		M.col(j) = val.V;
+	}
+
+	CPX* CDM::data() {
+		return M.data();
+	}
+
 	CDM& CDM::operator<<(CPX val) {
 		iterator[0] = 0;
 		iterator[1] = 0;
@@ -125,7 +184,7 @@ namespace utilsim {
 		return val;
 	}	
 
-	CDM CDM::operator*(CDM matrix) {
+	CDM CDM::operator*(const CDM& matrix) {
 		CDM val = CDM(0, 0);
 		val.M = this->M * matrix.M;
 		return val;
@@ -137,34 +196,34 @@ namespace utilsim {
 		return val;
 	}
 
-	CV CDM::operator*(CV mult) {
+	CV CDM::operator*(const CV& mult) {
 		CV val = CV(this->rows());
 		val.V = this->M * mult.V;
 		return val;
 	}
 
-	CDM CDM::operator/(CDM matrix) {
-		// Right division
+	CDM CDM::operator/(const CDM& matrix) {
+		// Right division, transposed solve instead of inverse
 		CDM val = CDM(0, 0);
-		val.M = this->M * matrix.M.inverse();
+		val.M = matrix.M.transpose().partialPivLu().solve(this->M.transpose()).transpose();
 		return val;
 	}
 
-	CDM CDM::operator|(CDM matrix) {
+	CDM CDM::operator|(const CDM& matrix) {
 		// Left division
 		CDM val = CDM(0, 0);
-		val.M = this->M.inverse() * matrix.M;
+		val.M = this->M.partialPivLu().solve(matrix.M);
 		return val;
 	}
 
-	CDM CDM::operator+(CDM adder) {
+	CDM CDM::operator+(const CDM& adder) {
 		// Left division
 		CDM val = CDM(0, 0);
 		val.M = this->M + adder.M;
 		return val;
 	}
 
-	CDM CDM::operator-(CDM deduct) {
+	CDM CDM::operator-(const CDM& deduct) {
 		// Left division
 		CDM val = CDM(0, 0);
 		val.M = this->M - deduct.M;
@@ -197,17 +256,161 @@ namespace utilsim {
 	}
 
 	void CSM::setElements(std::vector<int>& rows, std::vector<int>& cols, CDM& mtx) {
-		// Triplets preparation
-		std::vector<Triplet<CPX>> triplets(mtx.numel());
-		for (int i = 0; i < rows.size(); i++) {
-			for (int j = 0; j < cols.size(); j++) {
-				M.insert(rows[i], cols[j]) = mtx(i, j);				
+		// Overwriting, missing coefficients are inserted into the pattern
+		for (int i = 0; i < (int)rows.size(); i++) {
+			for (int j = 0; j < (int)cols.size(); j++) {
+				M.coeffRef(rows[i], cols[j]) = mtx(i, j);
 			}
 		}
 	}
 
+	void CSM::setZero() {
+		// Values only, pattern is preserved
+		if (Base != nullptr) {
+			std::fill(Values.begin(), Values.end(), CPX(0, 0));
+			return;
+		}
+		M.coeffs().setZero();
+	}
+
 	CPX& CSM::operator()(int i, int j) {
-		return M.insert(i, j);
+		return M.coeffRef(i, j);
+	}
+
+	void CSM::addPattern(std::vector<int>& rows, std::vector<int>& cols) {
+		// Structural entries only, duplicates are merged by buildPattern
+		Pattern.reserve(Pattern.size() + rows.size() * cols.size());
+		for (int i = 0; i < (int)rows.size(); i++) {
+			for (int j = 0; j < (int)cols.size(); j++) {
+				Pattern.push_back(Triplet<CPX>(rows[i], cols[j], CPX(0, 0)));
+			}
+		}
+	}
+
+	void CSM::buildPattern() {
+		M.setFromTriplets(Pattern.begin(), Pattern.end());
+		M.makeCompressed();
+		// Releasing collected triplets
+		std::vector<Triplet<CPX>>().swap(Pattern);
+	}
+
+	int CSM::rows() {
+		return Base != nullptr ? Base->rows() : (int)M.rows();
+	}
+
+	int CSM::nonZeros() {
+		return Base != nullptr ? (int)Values.size() : (int)M.nonZeros();
+	}
+
+	const int* CSM::outerIndex() {
+		M.makeCompressed();
+		return M.outerIndexPtr();
+	}
+
+	const int* CSM::innerIndex() {
+		M.makeCompressed();
+		return M.innerIndexPtr();
+	}
+
+	void CSM::setPattern(int nnz, const int* outer, const int* inner) {
+		M.setZero();
+		M.makeCompressed();
+		M.resizeNonZeros(nnz);
+		memcpy(M.outerIndexPtr(), outer, (M.cols() + 1) * sizeof(int));
+		memcpy(M.innerIndexPtr(), inner, nnz * sizeof(int));
+		std::fill(M.valuePtr(), M.valuePtr() + nnz, CPX(0, 0));
+	}
+
+	void CSM::share(CSM& base) {
+		base.M.makeCompressed();
+		M = SparseMatrix<CPX>(0, 0);
+		Base = &base;
+		Values.assign(base.M.valuePtr(), base.M.valuePtr() + base.M.nonZeros());
+	}
+
+	void CSM::copyValues(CSM& other) {
+		std::copy(other.values(), other.values() + other.nonZeros(), values());
+	}
+
+	CPX* CSM::values() {
+		return Base != nullptr ? Values.data() : M.valuePtr();
+	}
+
+	Map<const SparseMatrix<CPX>> CSM::view() {
+		// Shared pattern with private values
+		const SparseMatrix<CPX>& pat = Base->M;
+		return Map<const SparseMatrix<CPX>>(pat.rows(), pat.cols(), pat.nonZeros(), pat.outerIndexPtr(), pat.innerIndexPtr(), Values.data());
+	}
+
+	void CSM::getSlots(std::vector<int>& rows, std::vector<int>& cols, std::vector<int>& slots) {
+		// Slot is the position in the compressed value array, row-major over the block
+		const int* outer = M.outerIndexPtr();
+		const int* inner = M.innerIndexPtr();
+		slots.resize(rows.size() * cols.size());
+		int k = 0;
+		for (int i = 0; i < (int)rows.size(); i++) {
+			for (int j = 0; j < (int)cols.size(); j++) {
+				const int* pos = std::lower_bound(inner + outer[cols[j]], inner + outer[cols[j] + 1], rows[i]);
+				slots[k++] = (int)(pos - inner);
+			}
+		}
+	}
+
+	bool CSM::contains(std::vector<int>& rows, std::vector<int>& cols) {
+		const int* outer = M.outerIndexPtr();
+		const int* inner = M.innerIndexPtr();
+		for (int j = 0; j < (int)cols.size(); j++) {
+			if (cols[j] >= M.cols()) {
+				return false;
+			}
+			for (int i = 0; i < (int)rows.size(); i++) {
+				if (!std::binary_search(inner + outer[cols[j]], inner + outer[cols[j] + 1], rows[i])) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void CSM::setValues(std::vector<int>& slots, CDM& mtx) {
+		// One slot per block entry
+		assert(slots.size() == (size_t)mtx.rows() * mtx.cols());
+		CPX* val = values();
+		int k = 0;
+		for (int i = 0; i < mtx.rows(); i++) {
+			for (int j = 0; j < mtx.cols(); j++) {
+				val[slots[k++]] = mtx(i, j);
+			}
+		}
+	}
+
+	void CSM::addValue(std::vector<int>& slots, CPX val) {
+		CPX* vals = values();
+		for (auto slot : slots) {
+			vals[slot] += val;
+		}
+	}
+
+	void CSM::addValues(const std::vector<int>& slots, const CDM& mtx) {
+		assert(slots.size() == (size_t)mtx.rows() * mtx.cols());
+		CPX* val = values();
+		int k = 0;
+		for (int i = 0; i < mtx.rows(); i++) {
+			for (int j = 0; j < mtx.cols(); j++) {
+				val[slots[k++]] += mtx(i, j);
+			}
+		}
+	}
+
+	void CSM::subValues(const std::vector<int>& slots, const CDM& mtx) {
+		assert(slots.size() == (size_t)mtx.rows() * mtx.cols());
+		CPX* val = values();
+		int k = 0;
+		for (int i = 0; i < mtx.rows(); i++) {
+			for (int j = 0; j < mtx.cols(); j++) {
+				val[slots[k++]] -= mtx(i, j);
+			}
+		}
 	}
 
 	CSM CSM::operator*(CSM mult) {
@@ -223,12 +426,11 @@ namespace utilsim {
 	}
 
 	CV CSM::solve(CV load) {
-		CV val = CV(M.rows());
-		SparseLU<SparseMatrix<CPX>, COLAMDOrdering<int> >  solver;
-		solver.analyzePattern(M);
-		solver.factorize(M);
-		val.V = solver.solve(load.V);
-		return val;
+		// One-shot solution, use CSLU for repeated solves
+		CSLU solver;
+		solver.analyze(*this);
+		solver.factorize(*this);
+		return solver.solve(load);
 	}
 
 	void CSM::print() {
@@ -236,4 +438,258 @@ namespace utilsim {
 		std::cout << "COMPRESSED: " << M.isCompressed() << std::endl;
 	}
 
+	// Complex double sparse LU solver
+
+	void CSLU::analyze(CSM& mtx) {
+		if (mtx.Base != nullptr) {
+			Solver.analyzePattern(SparseMatrix<CPX>(mtx.view()));
+		}
+		else {
+			mtx.M.makeCompressed();
+			Solver.analyzePattern(mtx.M);
+		}
+		Analyzed = true;
+	}
+
+	thread_local const std::vector<int>* PresetOrdering::Preset = nullptr;
+
+	void CSLU::analyze(CSM& mtx, const std::vector<int>& ordering) {
+		PresetOrdering::Preset = &ordering;
+		analyze(mtx);
+		PresetOrdering::Preset = nullptr;
+	}
+
+	std::vector<int> CSLU::getOrdering() {
+		const auto& perm = Solver.colsPermutation().indices();
+		return std::vector<int>(perm.data(), perm.data() + perm.size());
+	}
+
+	bool CSLU::factorize(CSM& mtx) {
+		// Pattern must match the analyzed one
+		if (mtx.Base != nullptr) {
+			// Shared pattern, the solver keeps its own permuted copy either way
+			Solver.factorize(SparseMatrix<CPX>(mtx.view()));
+		}
+		else {
+			mtx.M.makeCompressed();
+			Solver.factorize(mtx.M);
+		}
+		return Solver.info() == Success;
+	}
+
+	CV CSLU::solve(CV load) {
+		CV val = CV(load.numel());
+		val.V = Solver.solve(load.V);
+		return val;
+	}
+
+	CDM CSLU::solve(CDM& loads) {
+		// All columns share one pass over the factors
+		CDM val = CDM(loads.rows(), loads.cols());
+		val.M = Solver.solve(loads.M);
+		return val;
+	}
+
+	bool CSLU::isAnalyzed() {
+		return Analyzed;
+	}
+
+	// CSLDU =============================================================
+
+	void CSLDU::analyze(CSM& mtx, const std::vector<std::vector<int>>& groups) {
+		int n = (int)mtx.M.rows();
+		// Requested blocks join the pattern as explicit zeros
+		std::vector<Triplet<CPX>> zeros;
+		for (auto& grp : groups) {
+			for (int i : grp) {
+				for (int j : grp) {
+					zeros.push_back(Triplet<CPX>(i, j, CPX(0, 0)));
+				}
+			}
+		}
+		Groups = SparseMatrix<CPX>(n, n);
+		Groups.setFromTriplets(zeros.begin(), zeros.end());
+		SparseMatrix<CPX> A = mtx.M + Groups;
+
+		// Minimum degree on the symmetrized pattern
+		PermutationMatrix<Dynamic, Dynamic, int> pinv;
+		AMDOrdering<int>()(A, pinv);
+		PermutationMatrix<Dynamic, Dynamic, int> perm = pinv.inverse();
+		Perm.assign(perm.indices().data(), perm.indices().data() + n);
+		SparseMatrix<CPX> C;
+		C = A.twistedBy(perm);
+		SparseMatrix<CPX> T = C.transpose();
+
+		// Elimination tree and column counts, both triangles contribute to the pattern
+		Parent.assign(n, -1);
+		std::vector<int> flag(n), count(n, 0);
+		for (int k = 0; k < n; k++) {
+			flag[k] = k;
+			for (auto* mat : { &C, &T }) {
+				for (SparseMatrix<CPX>::InnerIterator it(*mat, k); it; ++it) {
+					for (int i = (int)it.row(); i < k && flag[i] != k; i = Parent[i]) {
+						if (Parent[i] == -1) {
+							Parent[i] = k;
+						}
+						count[i]++;
+						flag[i] = k;
+					}
+				}
+			}
+		}
+		Lp.assign(n + 1, 0);
+		for (int k = 0; k < n; k++) {
+			Lp[k + 1] = Lp[k] + count[k];
+		}
+		Li.resize(Lp[n]);
+		Lx.resize(Lp[n]);
+		Ux.resize(Lp[n]);
+		D.resize(n);
+	}
+
+	bool CSLDU::factorize(CSM& mtx, double tolerance) {
+		int n = (int)D.size();
+		PermutationMatrix<Dynamic, Dynamic, int> perm(n);
+		for (int k = 0; k < n; k++) {
+			perm.indices()(k) = Perm[k];
+		}
+		SparseMatrix<CPX> A = mtx.M + Groups;
+		SparseMatrix<CPX> C;
+		C = A.twistedBy(perm);
+		SparseMatrix<CPX> T = C.transpose();
+
+		// Up-looking: column k of D*U and row k of L*D by sparse triangular solves
+		std::vector<CPX> y(n, 0), x(n, 0);
+		std::vector<int> flag(n), fill(n, 0), pattern(n);
+		for (int k = 0; k < n; k++) {
+			int top = n;
+			flag[k] = k;
+			// Largest original entry of row and column k scales the pivot test
+			double scale = 0;
+			for (auto* mat : { &C, &T }) {
+				std::vector<CPX>& acc = mat == &C ? y : x;
+				for (SparseMatrix<CPX>::InnerIterator it(*mat, k); it; ++it) {
+					int i = (int)it.row();
+					scale = std::max(scale, std::abs(it.value()));
+					if (i > k) {
+						continue;
+					}
+					acc[i] += it.value();
+					// Reach of i in the elimination tree
+					int len = 0;
+					for (; i < k && flag[i] != k; i = Parent[i]) {
+						pattern[len++] = i;
+						flag[i] = k;
+					}
+					while (len > 0) {
+						pattern[--top] = pattern[--len];
+					}
+				}
+			}
+			// Diagonal entry was accumulated by both triangles
+			D[k] = y[k];
+			y[k] = 0;
+			x[k] = 0;
+			for (; top < n; top++) {
+				int i = pattern[top];
+				CPX yi = y[i], xi = x[i];
+				y[i] = 0;
+				x[i] = 0;
+				int end = Lp[i] + fill[i];
+				for (int p = Lp[i]; p < end; p++) {
+					y[Li[p]] -= Lx[p] * yi;
+					x[Li[p]] -= Ux[p] * xi;
+				}
+				CPX l = xi / D[i];
+				CPX u = yi / D[i];
+				D[k] -= l * yi;
+				Li[end] = k;
+				Lx[end] = l;
+				Ux[end] = u;
+				fill[i]++;
+			}
+			if (std::abs(D[k]) <= tolerance * scale) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	CV CSLDU::solve(CV load) {
+		int n = (int)D.size();
+		CV x = CV::zeros(n);
+		for (int k = 0; k < n; k++) {
+			x[Perm[k]] = load[k];
+		}
+		// L * D * U * x = b, forward through unit L and D, backwards through unit U
+		for (int k = 0; k < n; k++) {
+			CPX xk = x[k];
+			for (int p = Lp[k]; p < Lp[k + 1]; p++) {
+				x[Li[p]] -= Lx[p] * xk;
+			}
+			x[k] = xk / D[k];
+		}
+		for (int k = n - 1; k >= 0; k--) {
+			CPX xk = x[k];
+			for (int p = Lp[k]; p < Lp[k + 1]; p++) {
+				xk -= Ux[p] * x[Li[p]];
+			}
+			x[k] = xk;
+		}
+		CV out = CV::zeros(n);
+		for (int k = 0; k < n; k++) {
+			out[k] = x[Perm[k]];
+		}
+		return out;
+	}
+
+	CPX& CSLDU::entry(std::vector<CPX>& lower, std::vector<CPX>& upper, int row, int col) {
+		// Column min(row, col) holds both triangles, rows are sorted
+		if (row == col) {
+			return Zd[row];
+		}
+		int c = std::min(row, col), r = std::max(row, col);
+		int p = (int)(std::lower_bound(Li.begin() + Lp[c], Li.begin() + Lp[c + 1], r) - Li.begin());
+		return row > col ? lower[p] : upper[p];
+	}
+
+	void CSLDU::invert() {
+		/*	Z = D^-1 * L^-1 + (I - U) * Z = U^-1 * D^-1 + Z * (I - L)
+			Z(i,j) = -sum U(i,k) * Z(k,j), Z(j,i) = -sum Z(j,k) * L(k,i) for j > i
+			Z(i,i) = 1 / D(i) - sum U(i,k) * Z(k,i)
+			every Z(k,j) needed lies on the pattern of the factors
+		*/
+		int n = (int)D.size();
+		Zl.assign(Lx.size(), 0);
+		Zu.assign(Ux.size(), 0);
+		Zd.assign(n, 0);
+		for (int i = n - 1; i >= 0; i--) {
+			for (int p = Lp[i]; p < Lp[i + 1]; p++) {
+				int j = Li[p];
+				CPX up = 0, low = 0;
+				for (int q = Lp[i]; q < Lp[i + 1]; q++) {
+					int k = Li[q];
+					up -= Ux[q] * entry(Zl, Zu, k, j);
+					low -= entry(Zl, Zu, j, k) * Lx[q];
+				}
+				Zu[p] = up;
+				Zl[p] = low;
+			}
+			CPX diag = CPX(1, 0) / D[i];
+			for (int p = Lp[i]; p < Lp[i + 1]; p++) {
+				diag -= Ux[p] * Zl[p];
+			}
+			Zd[i] = diag;
+		}
+	}
+
+	CPX CSLDU::inverse(int row, int col) {
+		int r = Perm[row], c = Perm[col];
+		int lo = std::min(r, c), hi = std::max(r, c);
+		if (lo != hi && !std::binary_search(Li.begin() + Lp[lo], Li.begin() + Lp[lo + 1], hi)) {
+			return CPX(0, 0);
+		}
+		return entry(Zl, Zu, r, c);
+	}
+
 }
@@ -11,6 +11,9 @@ typedef std::complex<double> CPX;
 using namespace Eigen;
 
 namespace utilsim {
+	template<int R, int C> class CFM;
+	template<int N> class CFLU;
+
 	// Complex double vector ------------------------------
 	class CV {
 	public:
@@ -21,7 +24,16 @@ namespace utilsim {
 		CV& operator,(CPX val);
 		// API
 		CPX& operator[](int i);
-		int numel();
+		CPX operator[](int i) const;
+		CV operator+(const CV& adder);
+		CV operator-(const CV& deduct);
+		// Fixed-size assignment, no reallocation when size is kept
+		template<int R> void set(const CFM<R, 1>& vec) {
+			V = vec.M;
+		}
+		int numel() const;
+		void setZero();
+		CPX* data();
 
 		// Debug
 		void print();
@@ -29,6 +41,7 @@ namespace utilsim {
 		// Factory
 		friend class CDM;
 		friend class CSM;
+		friend class CSLU;
 		static CV zeros(int numel);
 
 	private:
@@ -49,24 +62,39 @@ namespace utilsim {
 		friend CDM expm(CDM matrix);
 		// API
 		CPX& operator()(int i, int j);
+		CPX operator()(int i, int j) const;
 		CDM operator()(std::vector<int> rows, std::vector<int> cols);
+		CV col(int j);
+		void setCol(int j, CV& val);
+		// Column-major contiguous storage
+		CPX* data();
 		
-		CDM operator/(CDM den);
-		CDM operator|(CDM num);
-		CDM operator*(CDM mult);
+		CDM operator/(const CDM& den);
+		CDM operator|(const CDM& num);
+		CDM operator*(const CDM& mult);
 		CDM operator*(CPX factor);
-		CV operator*(CV mult);
-		CDM operator+(CDM adder);
-		CDM operator-(CDM deduct);
+		CV operator*(const CV& mult);
+		CDM operator+(const CDM& adder);
+		CDM operator-(const CDM& deduct);
+		// Fixed-size assignment, no reallocation when size is kept
+		template<int R, int C> void set(const CFM<R, C>& mtx) {
+			M = mtx.M;
+		}
 		int numel();
-		int rows();
-		int cols();
+		// Relative pivot threshold, zero - library default
+		int rank(double tolerance = 0);
+		// Eigen decomposition, M = vectors * diag(values) * vectors^-1
+		void eig(CDM& vectors, CV& values);
+		int rows() const;
+		int cols() const;
 		// Debug
 		void print();
 		// Factory
 		static CDM ones(int rows, int cols);
 		static CDM zeros(int rows, int cols);
 		static CDM eye(int dim);
+		friend class CSLU;
+		template<int R, int C> friend class CFM;
 	private:
 		int iterator[2];
 		Matrix<CPX, Eigen::Dynamic, Eigen::Dynamic> M;
@@ -74,6 +102,159 @@ namespace utilsim {
 
 	CDM expm(CDM matrix);
 
+	// Complex double fixed-size matrix ----------------------
+	// Stack storage for small element models, operators never allocate
+	template<int R, int C> class CFM {
+	public:
+		// Constructor
+		CFM() {}
+		explicit CFM(const CDM& mtx) : M(mtx.M) {}
+		// Comma filling
+		CFM& operator<<(CPX val) {
+			iterator[0] = 0;
+			iterator[1] = 0;
+			return *this, val;
+		}
+		CFM& operator,(CPX val) {
+			// Overflow handling
+			if (iterator[0] >= R || iterator[1] >= C) {
+				return *this;
+			}
+			// Assignment
+			M(iterator[0], iterator[1]) = val;
+			// Increment
+			if (++iterator[1] == C) {
+				iterator[1] = 0;
+				iterator[0]++;
+			}
+			return *this;
+		}
+		template<int R2, int C2> CFM& operator<<(const CFM<R2, C2>& submat) {
+			iterator[0] = 0;
+			iterator[1] = 0;
+			return *this, submat;
+		}
+		template<int R2, int C2> CFM& operator,(const CFM<R2, C2>& submat) {
+			// Overflow handling
+			if (iterator[0] + R2 > R || iterator[1] + C2 > C) {
+				return *this;
+			}
+			// Assignment
+			M.template block<R2, C2>(iterator[0], iterator[1]) = submat.M;
+			// Increment
+			iterator[1] += C2;
+			if (iterator[1] == C) {
+				iterator[1] = 0;
+				iterator[0] += R2;
+			}
+			return *this;
+		}
+		// API
+		CPX& operator()(int i, int j) {
+			return M(i, j);
+		}
+		CPX operator()(int i, int j) const {
+			return M(i, j);
+		}
+		template<int R2, int C2> CFM<R2, C2> block(int i, int j) const {
+			CFM<R2, C2> val;
+			val.M = M.template block<R2, C2>(i, j);
+			return val;
+		}
+		template<int C2> CFM<R, C2> operator*(const CFM<C, C2>& mult) const {
+			CFM<R, C2> val;
+			val.M.noalias() = M * mult.M;
+			return val;
+		}
+		CFM operator*(CPX factor) const {
+			CFM val;
+			val.M = M * factor;
+			return val;
+		}
+		CFM operator+(const CFM& adder) const {
+			CFM val;
+			val.M = M + adder.M;
+			return val;
+		}
+		CFM operator-(const CFM& deduct) const {
+			CFM val;
+			val.M = M - deduct.M;
+			return val;
+		}
+		// Right division
+		CFM operator/(const CFM<C, C>& den) const;
+		CFM operator/(const CFLU<C>& den) const;
+		// Left division
+		template<int C2> CFM<C, C2> operator|(const CFM<R, C2>& num) const;
+		// Debug
+		void print() {
+			std::cout << M << std::endl << std::endl;
+		}
+		// Factory
+		static CFM ones() {
+			CFM val;
+			val.M.setOnes();
+			return val;
+		}
+		static CFM zeros() {
+			CFM val;
+			val.M.setZero();
+			return val;
+		}
+		static CFM eye() {
+			CFM val;
+			val.M.setIdentity();
+			return val;
+		}
+		template<int R2, int C2> friend class CFM;
+		template<int N> friend class CFLU;
+		friend class CV;
+		friend class CDM;
+	private:
+		int iterator[2];
+		Matrix<CPX, R, C> M;
+	};
+
+	// Complex double fixed-size LU factorization ------------
+	// Factored once, reused for any number of left and right divisions
+	template<int N> class CFLU {
+	public:
+		CFLU(const CFM<N, N>& mtx) : LU(mtx.M) {}
+		// Left division, M^-1 * num
+		template<int C> CFM<N, C> operator|(const CFM<N, C>& num) const {
+			CFM<N, C> val;
+			val.M = LU.solve(num.M);
+			return val;
+		}
+		// Right division, num * M^-1 = (M^-T * num^T)^T with P*M = L*U
+		template<int R> CFM<R, N> rdivide(const CFM<R, N>& num) const {
+			Matrix<CPX, N, R> tmp = LU.matrixLU().template triangularView<Upper>().transpose().solve(num.M.transpose());
+			LU.matrixLU().template triangularView<UnitLower>().transpose().solveInPlace(tmp);
+			CFM<R, N> val;
+			val.M = (LU.permutationP().transpose() * tmp).transpose();
+			return val;
+		}
+		CFM<N, N> inverse() const {
+			CFM<N, N> val;
+			val.M = LU.inverse();
+			return val;
+		}
+	private:
+		PartialPivLU<Matrix<CPX, N, N>> LU;
+	};
+
+	template<int R, int C> CFM<R, C> CFM<R, C>::operator/(const CFM<C, C>& den) const {
+		return *this / CFLU<C>(den);
+	}
+
+	template<int R, int C> CFM<R, C> CFM<R, C>::operator/(const CFLU<C>& den) const {
+		return den.rdivide(*this);
+	}
+
+	template<int R, int C> template<int C2> CFM<C, C2> CFM<R, C>::operator|(const CFM<R, C2>& num) const {
+		return CFLU<R>(*this) | num;
+	}
+
 	// Complex double sparse matrix --------------------------
 	class CSM {
 	public:
@@ -81,14 +262,115 @@ namespace utilsim {
 		CSM(int nrows, int ncols);
 		// Setter
 		void setElements(std::vector<int>& rows, std::vector<int>& cols, CDM& mtx);
+		void setZero();
 		CPX& operator()(int i, int j);
+		// Two-phase assembly
+		// 1 - pattern collection and compression (once per topology)
+		void addPattern(std::vector<int>& rows, std::vector<int>& cols);
+		void buildPattern();
+		// 2 - value slots, stable until next buildPattern
+		void getSlots(std::vector<int>& rows, std::vector<int>& cols, std::vector<int>& slots);
+		void setValues(std::vector<int>& slots, CDM& mtx);
+		void addValues(const std::vector<int>& slots, const CDM& mtx);
+		void subValues(const std::vector<int>& slots, const CDM& mtx);
+		void addValue(std::vector<int>& slots, CPX val);
+		// Whether the block is covered by the current pattern
+		bool contains(std::vector<int>& rows, std::vector<int>& cols);
+		// Raw compressed pattern, column-major
+		int rows();
+		int nonZeros();
+		const int* outerIndex();
+		const int* innerIndex();
+		// Pattern restored from raw arrays, values zeroed
+		void setPattern(int nnz, const int* outer, const int* inner);
+		// Values over the pattern of base, which has to outlive this matrix and keep its pattern
+		// Shared matrices take value updates and factorization only
+		void share(CSM& base);
+		// Values of a matrix with the same pattern, no reallocation
+		void copyValues(CSM& other);
 		CSM operator*(CSM mult);
 		CV operator*(CV mult);
 		CV solve(CV load);
 		// Debug
 		void print();
 	private:
+		friend class CSLU;
+		friend class CSLDU;
 		SparseMatrix<CPX> M;
+		std::vector<Triplet<CPX>> Pattern;
+		// Shared pattern owner and private values
+		CSM* Base = nullptr;
+		std::vector<CPX> Values;
+		CPX* values();
+		Map<const SparseMatrix<CPX>> view();
+	};
+
+	// Fill-reducing column ordering, COLAMD unless a preset is given for the running analysis
+	class PresetOrdering {
+	public:
+		typedef PermutationMatrix<Dynamic, Dynamic, int> PermutationType;
+		template<class MatrixType> void operator()(const MatrixType& mat, PermutationType& perm) {
+			if (Preset != nullptr && (int)Preset->size() == mat.cols()) {
+				perm.resize(mat.cols());
+				for (int k = 0; k < (int)Preset->size(); k++) {
+					perm.indices()(k) = (*Preset)[k];
+				}
+				return;
+			}
+			COLAMDOrdering<int>()(mat, perm);
+		}
+		static thread_local const std::vector<int>* Preset;
+	};
+
+	// Complex double sparse LU solver -----------------------
+	class CSLU {
+	public:
+		// Symbolic stage - ordering and elimination tree, pattern dependent only
+		void analyze(CSM& mtx);
+		// Symbolic stage with known column ordering, e.g. of an earlier analysis
+		void analyze(CSM& mtx, const std::vector<int>& ordering);
+		std::vector<int> getOrdering();
+		// Numeric stage - reuses last symbolic analysis, false on a singular matrix
+		bool factorize(CSM& mtx);
+		CV solve(CV load);
+		// Block solution, one right-hand side per column
+		CDM solve(CDM& loads);
+		bool isAnalyzed();
+	private:
+		bool Analyzed = false;
+		SparseLU<SparseMatrix<CPX>, PresetOrdering> Solver;
+	};
+
+	// Complex sparse LDU without pivoting, symmetric pattern ---
+	// Selected inversion: entries of the inverse on the pattern of the factors (Takahashi)
+	class CSLDU {
+	public:
+		// Symbolic stage, groups are index sets whose inverse blocks are requested
+		void analyze(CSM& mtx, const std::vector<std::vector<int>>& groups = {});
+		// Numeric stage without pivoting, false on a pivot below tolerance relative to its row and column
+		bool factorize(CSM& mtx, double tolerance = 1e-12);
+		// Solution through the factors, elimination order undone
+		CV solve(CV load);
+		// Inverse on the factor pattern, backwards over the elimination order
+		void invert();
+		// Entry of the inverse, zero outside the factor pattern
+		CPX inverse(int row, int col);
+	private:
+		CPX& entry(std::vector<CPX>& lower, std::vector<CPX>& upper, int row, int col);
+		SparseMatrix<CPX> Groups;
+		// Original index to elimination position
+		std::vector<int> Perm;
+		// Column k of L and row k of U share Li[Lp[k]..Lp[k+1])
+		std::vector<int> Lp;
+		std::vector<int> Li;
+		std::vector<int> Parent;
+		std::vector<CPX> Lx;
+		std::vector<CPX> Ux;
+		std::vector<CPX> D;
+		// Inverse in the same layout
+		std::vector<CPX> Zl;
+		std::vector<CPX> Zu;
+		std::vector<CPX> Zd;
 	};
 }
 #endif
\ No newline at end of file
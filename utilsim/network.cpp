@@ -1,8 +1,10 @@
 #include "network.hpp"
+#include <algorithm>
+#include <unordered_set>
 
 namespace utilsim
 {
-	Network::Network() : SIGMA(CSM(0, 0)), T(CSM(0, 0)), J(CV::zeros(0)){
+	Network::Network() : Y(CSM(0, 0)), R(CV::zeros(0)), V(CV::zeros(0)){
 		// Badge initialization
 		ID = NID();
 		ID.Owner = this;
@@ -12,23 +14,253 @@ namespace utilsim
 		for (auto J : Junctions) {
 			delete J;
 		}
-		for (auto E : Elements) {
-			delete E;
+		for (auto& K : Kinds) {
+			delete K.second.Storage;
 		}
 		for (auto L : Archive) {
 			delete L;
 		}
 	}
 
+	void NID::notify(Junction* jnt) {
+		Owner->ModifiedJunctions.push_back(jnt);
+	}
+
+	void NID::notify(Element* elem) {
+		Owner->ModifiedElements.push_back(elem);
+	}
+
+	bool NID::defer(Element* elem, ModifiedState prior) {
+		if (Owner->CalcMode != Mode::TRANSACTIONAL) {
+			return false;
+		}
+		Owner->PendingTopology.push_back({ elem, prior });
+		return true;
+	}
+
+	bool NID::defer(Element* elem, int port, Junction* jnt) {
+		if (Owner->CalcMode != Mode::TRANSACTIONAL) {
+			return false;
+		}
+		Owner->PendingConnections.push_back({ elem->getPort(port), jnt });
+		return true;
+	}
+
+	void NID::log(SettingsData* sd, int inst, const SettingKey& key) {
+		Owner->record(sd, inst, key);
+	}
+
+	double NID::getFrequency() {
+		return Owner->Frequency;
+	}
+
+	double NID::getRatedFrequency() {
+		return Owner->RatedFrequency;
+	}
+
 	Junction* Network::insertJunction() {
 		// Producing
 		Junction* jnt = new Junction(&ID);
 
 		// Saving
 		Junctions.push_back(jnt);
+		ModifiedJunctions.push_back(jnt);
 		return jnt;
 	}
 
+	Element* Network::insertElement(const char* kind) {
+		if (!strcmp(kind, "SOURCE")) {
+			return insertElement<Source>();
+		}
+		if (!strcmp(kind, "LINE")) {
+			return insertElement<Line>();
+		}
+		if (!strcmp(kind, "LOAD")) {
+			return insertElement<Load>();
+		}
+		return nullptr;
+	}
+
+	Record* Network::appendLibrary(const char* kind) {
+		if (!strcmp(kind, "LINE")) {
+			return appendLibrary<Line>();
+		}
+		return nullptr;
+	}
+
+	void Network::reserve(int junctions) {
+		Junctions.reserve(Junctions.size() + junctions);
+	}
+
+	SettingKey Network::getKey(type_index kind, const char* name) {
+		auto it = Kinds.find(kind);
+		if (it == Kinds.end()) {
+			return SettingKey();
+		}
+		return it->second.Schema->getKey(name);
+	}
+
+	int Network::countElements(type_index kind) {
+		auto it = Kinds.find(kind);
+		if (it == Kinds.end()) {
+			return 0;
+		}
+		return (int)it->second.Members.size();
+	}
+
+	int Network::setValues(type_index kind, const SettingKey& key, const void* values) {
+		auto it = Kinds.find(kind);
+		if (it == Kinds.end()) {
+			return 0;
+		}
+		Kind& K = it->second;
+		// Previous column values, only the entries that change are logged for rollback
+		vector<char> prior;
+		if (CalcMode == Mode::TRANSACTIONAL && K.Schema->owns(key)) {
+			prior.resize(K.Members.size() * key.Bytes);
+			for (size_t k = 0; k < K.Members.size(); k++) {
+				K.Schema->getValue<char>(K.Instances[k], key, prior.data() + k * key.Bytes);
+			}
+		}
+		// Single pass over the setting column
+		K.Modified.clear();
+		unsigned char status = K.Schema->setValues(key, K.Instances.data(), values, (int)K.Members.size(), K.Modified);
+		if (!prior.empty()) {
+			for (auto k : K.Modified) {
+				record(K.Schema, K.Instances[k], key, prior.data() + k * key.Bytes);
+			}
+		}
+		// Rizing flags on modified elements only
+		ModifiedState state = (status & (1 << (int)SettingStatus::Topology)) ? ModifiedState::TOPOLOGY : ModifiedState::PARAMETRIC;
+		for (auto k : K.Modified) {
+			K.Members[k]->raise(state);
+		}
+		return (int)K.Modified.size();
+	}
+
+	// Transactions
+
+	void Network::begin() {
+		CalcMode = Mode::TRANSACTIONAL;
+	}
+
+	void Network::record(SettingsData* sd, int inst, const SettingKey& key, const void* prior) {
+		if (CalcMode != Mode::TRANSACTIONAL || !sd->owns(key)) {
+			return;
+		}
+		UndoLog.push_back({ sd, inst, key, UndoData.size() });
+		UndoData.resize(UndoData.size() + key.Bytes);
+		if (prior != nullptr) {
+			memcpy(UndoData.data() + UndoLog.back().Offset, prior, key.Bytes);
+		}
+		else {
+			sd->getValue<char>(inst, key, UndoData.data() + UndoLog.back().Offset);
+		}
+	}
+
+	void Network::commit() {
+		if (CalcMode != Mode::TRANSACTIONAL) {
+			return;
+		}
+		CalcMode = Mode::INTERACTIVE;
+		// Port rewiring once per element for the final settings, in queue order
+		unordered_set<Element*> rewired;
+		for (auto& rw : PendingTopology) {
+			if (rewired.insert(rw.Elem).second) {
+				rw.Elem->updateTopology();
+			}
+		}
+		// Last connection of a port wins, kept at its queue position
+		unordered_set<Port*> linked;
+		vector<Link> links;
+		for (auto it = PendingConnections.rbegin(); it != PendingConnections.rend(); ++it) {
+			if (linked.insert(it->Prt).second && it->Prt->Connection != it->Jnt) {
+				links.push_back(*it);
+			}
+		}
+		reverse(links.begin(), links.end());
+		// Moved ports leave the junctions they had before the transaction
+		for (auto& lnk : links) {
+			if (lnk.Prt->Connection != nullptr) {
+				lnk.Prt->Connection->disconnectPort(lnk.Prt);
+			}
+		}
+		// One wiring pass per junction, junctions in order of their first connection
+		unordered_map<Junction*, size_t> group;
+		vector<Junction*> targets;
+		vector<vector<Port*>> ports;
+		for (auto& lnk : links) {
+			auto gt = group.emplace(lnk.Jnt, targets.size());
+			if (gt.second) {
+				targets.push_back(lnk.Jnt);
+				ports.emplace_back();
+			}
+			lnk.Prt->Connection = lnk.Jnt;
+			ports[gt.first->second].push_back(lnk.Prt);
+		}
+		for (size_t k = 0; k < targets.size(); k++) {
+			targets[k]->connectPorts(ports[k].data(), (int)ports[k].size());
+		}
+		PendingTopology.clear();
+		PendingConnections.clear();
+		UndoLog.clear();
+		UndoData.clear();
+	}
+
+	void Network::rollback() {
+		if (CalcMode != Mode::TRANSACTIONAL) {
+			return;
+		}
+		CalcMode = Mode::INTERACTIVE;
+		// Settings restored newest first, so the oldest value remains
+		for (auto it = UndoLog.rbegin(); it != UndoLog.rend(); ++it) {
+			it->Schema->setValue<char>(it->Instance, it->Key, UndoData.data() + it->Offset);
+		}
+		// Ports were never rewired, elements fall back to their state before the transaction
+		for (auto it = PendingTopology.rbegin(); it != PendingTopology.rend(); ++it) {
+			// Already registered as modified, the restamp leaves values unchanged
+			it->Elem->State = it->Prior == ModifiedState::NONE ? ModifiedState::PARAMETRIC : it->Prior;
+		}
+		PendingTopology.clear();
+		PendingConnections.clear();
+		UndoLog.clear();
+		UndoData.clear();
+	}
+
+	Mode Network::getMode() {
+		return CalcMode;
+	}
+
+	// Frequency
+
+	void Network::setFrequency(double hz) {
+		if (hz == Frequency) {
+			return;
+		}
+		Frequency = hz;
+		for (auto elem : Elements) {
+			elem->raise(ModifiedState::PARAMETRIC);
+		}
+	}
+
+	double Network::getFrequency() {
+		return Frequency;
+	}
+
+	void Network::setRatedFrequency(double hz) {
+		if (hz == RatedFrequency) {
+			return;
+		}
+		RatedFrequency = hz;
+		for (auto elem : Elements) {
+			elem->raise(ModifiedState::PARAMETRIC);
+		}
+	}
+
+	double Network::getRatedFrequency() {
+		return RatedFrequency;
+	}
+
 	void Network::print() {
 		cout << "Network statistics:\n";
 		for (auto e : Elements) {
@@ -39,59 +271,301 @@ namespace utilsim
 		}
 	}
 
-	void Network::compute() {
-		// Identifying network state
-		bool topologyChanged = false;
-		for (auto jnt : Junctions) {
-			topologyChanged = topologyChanged || (jnt->getState() == ModifiedState::TOPOLOGY);
+	CV& Network::getVoltages() {
+		return V;
+	}
+
+	JunctionView Network::view(Junction* jnt) {
+		return JunctionView(jnt, V);
+	}
+
+	ElementView Network::view(Element* elem) {
+		return ElementView(elem, V);
+	}
+
+	CSpan Network::getCurrents() {
+		if (!CurrentsReady) {
+			I = CV::zeros(IDOFS);
+			for (auto elem : Elements) {
+				view(elem).currents(I.data() + elem->getFirstDOF());
+			}
+			CurrentsReady = true;
+		}
+		return CSpan(I.data(), I.numel());
+	}
+
+	int Network::getVoltageDOFs() {
+		return VDOFS;
+	}
+
+	int Network::getCurrentDOFs() {
+		return IDOFS;
+	}
+
+	bool Network::reindex(vector<Junction*>& jnts, vector<Element*>& elems) {
+		// Compaction once abandoned DOFs dominate, numbering restarts from scratch
+		bool reset = VDOFS == 0 || 4 * (int)Spares.size() > VDOFS;
+		if (reset) {
+			jnts = Junctions;
+			elems = Elements;
+			VDOFS = 0;
+			IDOFS = 0;
+			Spare.clear();
+			Incidence.clear();
+		}
+		int v_idx = VDOFS;
+		int i_idx = IDOFS;
+		// Junction blocks, moved ones leave spare DOFs behind
+		vector<Element*> affected = elems;
+		for (auto jnt : jnts) {
+			int first = jnt->getFirstDOF();
+			int capacity = jnt->getCapacity();
+			jnt->index(v_idx, reset);
+			Spare.resize(v_idx, 1);
+			if (!reset && jnt->getFirstDOF() != first) {
+				fill(Spare.begin() + first, Spare.begin() + first + capacity, 1);
+			}
+			first = jnt->getFirstDOF();
+			int live = jnt->countConductors();
+			for (int k = 0; k < jnt->getCapacity(); k++) {
+				Spare[first + k] = k >= live;
+			}
+			// Renumbered conductors invalidate nodes of every connected element
+			for (auto prt : jnt->ConnectedPorts) {
+				affected.push_back(prt->Parent);
+			}
+		}
+		// Terminal blocks, unused terminal DOFs map nowhere
+		for (auto elem : elems) {
+			int first = elem->getFirstDOF();
+			int capacity = elem->getCapacity();
+			elem->index(i_idx, reset);
+			Incidence.resize(i_idx, -1);
+			if (!reset) {
+				fill(Incidence.begin() + first, Incidence.begin() + first + capacity, -1);
+			}
+			fill(Incidence.begin() + elem->getFirstDOF(), Incidence.begin() + elem->getFirstDOF() + elem->getCapacity(), -1);
+		}
+		sort(affected.begin(), affected.end());
+		affected.erase(unique(affected.begin(), affected.end()), affected.end());
+
+		// Pattern is kept when every affected stamp still fits in it
+		bool rebuild = reset || v_idx != VDOFS;
+		VDOFS = v_idx;
+		IDOFS = i_idx;
+		for (auto elem : affected) {
+			elem->nodes();
+			elem->map(Incidence);
+			rebuild = rebuild || !Y.contains(elem->getNodes(), elem->getNodes());
+		}
+		Spares.clear();
+		for (int k = 0; k < VDOFS; k++) {
+			if (Spare[k]) {
+				Spares.push_back(k);
+				vector<int> dof = { k };
+				rebuild = rebuild || !Y.contains(dof, dof);
+			}
+		}
+		if (!rebuild) {
+			for (auto elem : affected) {
+				elem->locate(Y);
+			}
+		}
+		return rebuild;
+	}
+
+	bool Network::restored() {
+		// Restored pattern covers every element stamp and spare DOF
+		if (Y.rows() != VDOFS) {
+			return false;
 		}
 		for (auto elem : Elements) {
-			topologyChanged = topologyChanged || (elem->getState() == ModifiedState::TOPOLOGY);
+			if (!Y.contains(elem->getNodes(), elem->getNodes())) {
+				return false;
+			}
+		}
+		for (auto k : Spares) {
+			vector<int> dof = { k };
+			if (!Y.contains(dof, dof)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Network::assemble(bool factorize) {
+		// Identifying network state from objects changed since the last calculation
+		vector<Junction*> jnts;
+		vector<Element*> elems;
+		for (auto jnt : ModifiedJunctions) {
+			if (jnt->getState() == ModifiedState::TOPOLOGY) {
+				jnts.push_back(jnt);
+			}
+		}
+		for (auto elem : ModifiedElements) {
+			if (elem->getState() == ModifiedState::TOPOLOGY) {
+				elems.push_back(elem);
+			}
+			Kinds[typeid(*elem)].Dirty.push_back(elem);
 		}
+		bool topologyChanged = !jnts.empty() || !elems.empty();
+		bool parametersChanged = !ModifiedElements.empty();
+		// Delta stamping pays off while few elements change, a full restamp clears its drift
+		bool restamp = topologyChanged || 2 * ModifiedElements.size() > Elements.size() || (parametersChanged && Deltas >= RestampPeriod);
+		ModifiedJunctions.clear();
+		ModifiedElements.clear();
 		// Updating
+		bool rebuild = false;
 		if (topologyChanged) {
-			int v_idx = 0;
-			for (auto jnt : Junctions) {			
-				jnt->index(v_idx);			
-			}		
-			int i_idx = 0;
-			for (auto elem : Elements) {
-				elem->index(i_idx);
+			// Only changed junctions and elements are renumbered
+			rebuild = reindex(jnts, elems);
+			if (rebuild) {
+				// Pattern is built once per topology, elements keep their value slots
+				if (PatternReady && !restored()) {
+					// Restored pattern does not match the network
+					PatternReady = false;
+					Ordering.clear();
+				}
+				if (!PatternReady || Y.rows() != VDOFS) {
+					Y = CSM(VDOFS, VDOFS);
+					for (auto elem : Elements) {
+						elem->pattern(Y);
+					}
+					for (auto k : Spares) {
+						vector<int> dof = { k };
+						Y.addPattern(dof, dof);
+					}
+					Y.buildPattern();
+				}
+				for (auto elem : Elements) {
+					elem->locate(Y);
+				}
+			}
+			PatternReady = false;
+			SpareSlots.resize(Spares.size());
+			for (int k = 0; k < (int)Spares.size(); k++) {
+				vector<int> dof = { Spares[k] };
+				vector<int> slot;
+				Y.getSlots(dof, dof, slot);
+				SpareSlots[k] = slot[0];
+			}
+			if (R.numel() != VDOFS) {
+				R = CV::zeros(VDOFS);
 			}
-			SIGMA = CSM(i_idx, v_idx);
-			T = CSM(v_idx, i_idx);
-			J = CV::zeros(i_idx);
-			std::cout << "Calculation. VDOFS: " << v_idx << " IDOFS: " << i_idx << std::endl;
 		}
-		
-		for (auto elem : Elements) {
-			if (topologyChanged || (elem->getState() == ModifiedState::PARAMETRIC)) {
-				elem->fill(SIGMA,J);
-			}			
+
+		// Direct nodal assembly, models are refreshed for modified elements only
+		if (restamp) {
+			// Values are overwritten in place and every element is stamped again
+			Y.setZero();
+			R.setZero();
+			for (auto& K : Kinds) {
+				K.second.Storage->update(K.second.Dirty);
+			}
+			for (auto& K : Kinds) {
+				K.second.Storage->fill(Y, R);
+			}
+			// Unit diagonal keeps abandoned DOFs decoupled
+			Y.addValue(SpareSlots, CPX(1, 0));
+			Deltas = 0;
+		}
+		else if (parametersChanged) {
+			Deltas++;
+			// Delta stamping, old contributions of modified elements are replaced
+			for (auto& K : Kinds) {
+				for (auto elem : K.second.Dirty) {
+					elem->unfill(Y, R);
+				}
+				K.second.Storage->update(K.second.Dirty);
+				for (auto elem : K.second.Dirty) {
+					elem->fill(Y, R);
+				}
+			}
 		}
-		for (auto jnt : Junctions) {
-			if (topologyChanged || (jnt->getState() == ModifiedState::PARAMETRIC)) {
-				jnt->fill(T);
-			}			
+		for (auto& K : Kinds) {
+			K.second.Dirty.clear();
 		}
 
-		CSM L = T * SIGMA;
-		CV R = T * J;
+		// Symbolic analysis only when the pattern changed, numeric refactorization otherwise
+		if (rebuild || !Solver.isAnalyzed()) {
+			if ((int)Ordering.size() == VDOFS) {
+				Solver.analyze(Y, Ordering);
+			}
+			else {
+				Solver.analyze(Y);
+			}
+			Ordering.clear();
+			parametersChanged = true;
+		}
+		if (topologyChanged) {
+			Layout++;
+		}
+		if (topologyChanged || parametersChanged) {
+			Factorized = false;
+			Singular = false;
+			Revision++;
+		}
+		if (factorize && !Factorized && !Singular) {
+			// Failure is kept until the next change, no refactorization of the same values
+			Factorized = Solver.factorize(Y);
+			Singular = !Factorized;
+		}
+	}
 
-		CV RES = L.solve(R);
+	bool Network::compute() {
+		commit();
+		assemble();
+		CurrentsReady = false;
+		Solution = Revision;
+		if (!Factorized) {
+			// Views stay within the current numbering
+			V = CV::zeros(VDOFS);
+			return false;
+		}
+		V = Solver.solve(R);
 
-		//RES.print();
+		//V.print();
 
-		//std::cout << "SIGMA" << std::endl;
-		//SIGMA.print();
-		//std::cout << "T" << std::endl;
-		//T.print();
-		//std::cout << "J" << std::endl;
-		//J.print();
+		//std::cout << "Y" << std::endl;
+		//Y.print();
+		//std::cout << "R" << std::endl;
+		//R.print();
 
 		// mapping junction - list of nodes
 		// Store indices inside elements
+		return true;
 	}
 
+	void Network::freeze() {
+		if (isFrozen()) {
+			return;
+		}
+		commit();
+		assemble();
+		if (Solution != Revision) {
+			compute();
+		}
+	}
+
+	bool Network::isFrozen() {
+		return CalcMode != Mode::TRANSACTIONAL && ModifiedElements.empty() && ModifiedJunctions.empty() && Solution == Revision;
+	}
 
+	CDM Network::compute(CDM& sources) {
+		commit();
+		assemble();
+		if (!Factorized || sources.rows() != IDOFS) {
+			return CDM(0, 0);
+		}
+		// Projecting terminal sources onto conductors, R = -T * J for every column
+		CDM loads = CDM::zeros(VDOFS, sources.cols());
+		for (int k = 0; k < sources.cols(); k++) {
+			for (int i = 0; i < IDOFS; i++) {
+				if (Incidence[i] >= 0) {
+					loads(Incidence[i], k) -= sources(i, k);
+				}
+			}
+		}
+		return Solver.solve(loads);
+	}
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef NETWORK_HPP
 #define NETWORK_HPP
 #include "elements.hpp"
+#include "results.hpp"
+#include <typeindex>
 
 // Network model database
 
@@ -11,42 +13,208 @@ namespace utilsim
 
 	// Network identification badge
 	class NID {
+	public:
+		// Change registration, objects report their first modification since the last calculation
+		void notify(Junction* jnt);
+		void notify(Element* elem);
+		// Transaction hooks, true if the operation is postponed to the commit
+		bool defer(Element* elem, ModifiedState prior);
+		bool defer(Element* elem, int port, Junction* jnt);
+		// Previous setting value for rollback
+		void log(SettingsData* sd, int inst, const SettingKey& key);
+		// Analysis frequency for element models
+		double getFrequency();
+		double getRatedFrequency();
 	private:
 		Network* Owner;		
 		friend class Network;
 	};
 
+	class Contingency;
+	class Snapshot;
+	class Scenario;
+	class Sweep;
+	class Transient;
+	class ShortCircuit;
+
 	// Network objects database
 	class Network {
 	public:		
 		Network();
 		~Network();
 		template<class T> T* insertElement() {
-			// Constructing
-			Element* elem = new T(&ID);
+			// Constructing in per-type storage
+			Kind& kind = Kinds[typeid(T)];
+			T* elem = getPool<T>(kind)->insert(&ID);
 			// Saving
 			Elements.push_back(elem);
-			return (T*)elem;
+			ModifiedElements.push_back(elem);
+			kind.Members.push_back(elem);
+			kind.Instances.push_back(elem->getInstance());
+			kind.Schema = elem->getSettings();
+			return elem;
+		}
+		// Bulk settings update per element kind, one value per element in insertion order
+		template<class T> SettingKey getKey(const char* name) {
+			return getKey(typeid(T), name);
+		}
+		template<class T> int setValues(const SettingKey& key, const void* values) {
+			return setValues(typeid(T), key, values);
 		}
+		template<class T> int countElements() {
+			return countElements(typeid(T));
+		}
+		// Construction by settings kind name, nullptr for unknown kinds
+		Element* insertElement(const char* kind);
+		Record* appendLibrary(const char* kind);
+		SettingKey getKey(type_index kind, const char* name);
+		int setValues(type_index kind, const SettingKey& key, const void* values);
+		int countElements(type_index kind);
 		template<class T> Record* appendLibrary() {
 			// Constructing	
-			void* data = T::LSD.getInstance();
+			int data = T::LSD.getInstance();
 			Record* R = new Record(data, &T::LSD);
 			// Saving
 			Archive.push_back(R);
 			return R;
 		}
 		Junction* insertJunction();
-		void compute();
+		// Capacity hints for bulk construction
+		template<class T> void reserve(int count) {
+			Kind& kind = Kinds[typeid(T)];
+			getPool<T>(kind)->reserve(count);
+			kind.Members.reserve(kind.Members.size() + count);
+			kind.Instances.reserve(kind.Instances.size() + count);
+			Elements.reserve(Elements.size() + count);
+		}
+		void reserve(int junctions);
+		// Transactions, settings are written immediately while port rewiring and connections
+		// wait for the commit and are applied once per element
+		/*	Rollback restores element settings and drops pending connections.
+			Library records, junction edits and insertions are not part of transactions.
+		*/
+		void begin();
+		void commit();
+		void rollback();
+		Mode getMode();
+		// Analysis frequency in Hz, every element model is refreshed on change
+		void setFrequency(double hz);
+		double getFrequency();
+		// Frequency of the reactances given in lumped element settings
+		void setRatedFrequency(double hz);
+		double getRatedFrequency();
+		// Pending transaction is committed first, false on a singular network with voltages zeroed
+		bool compute();
+		// Last solution, conductor voltages by DOF
+		CV& getVoltages();
+		// Base of concurrent scenarios, committed, assembled and solved once before forking,
+		// a frozen network is only read by its scenarios until its next change
+		void freeze();
+		bool isFrozen();
+		// Result views, valid until the next calculation
+		JunctionView view(Junction* jnt);
+		ElementView view(Element* elem);
+		// Terminal currents by terminal DOF, evaluated once per solution
+		CSpan getCurrents();
+		// Batch solution with alternative source terms J (terminal DOFs by scenarios),
+		// empty on a singular network or when the rows differ from getCurrentDOFs()
+		CDM compute(CDM& sources);
+		int getVoltageDOFs();
+		int getCurrentDOFs();
 		void print();
 	private:
+		friend class Contingency;
+		friend class Snapshot;
+		friend class Scenario;
+		friend class Sweep;
+		friend class Transient;
+		friend class ShortCircuit;
+		friend class NID;
+		// Elements of one concrete type
+		struct Kind {
+			PoolBase* Storage = nullptr;
+			SettingsData* Schema = nullptr;
+			vector<Element*> Members;
+			vector<int> Instances;
+			vector<int> Modified;
+			// Elements of the kind changed since the last calculation
+			vector<Element*> Dirty;
+		};
+		map<type_index, Kind> Kinds;
+		template<class T> Pool<T>* getPool(Kind& kind) {
+			if (kind.Storage == nullptr) {
+				kind.Storage = new Pool<T>();
+			}
+			return static_cast<Pool<T>*>(kind.Storage);
+		}
+		// Numeric factorization may be left to the caller
+		void assemble(bool factorize = true);
+		// Previous value is read from the settings unless given
+		void record(SettingsData* sd, int inst, const SettingKey& key, const void* prior = nullptr);
+		// Incremental numbering of changed objects, true if the pattern has to be rebuilt
+		bool reindex(vector<Junction*>& jnts, vector<Element*>& elems);
+		// Restored snapshot pattern is used only if it covers the current stamps
+		bool restored();
 		NID ID;
 		vector<Element*> Elements;
 		vector<Junction*> Junctions;
 		vector<Record*> Archive;
-		CSM SIGMA;
-		CSM T;
-		CV J;
+		// Objects changed since the last calculation, visited instead of the whole network
+		vector<Junction*> ModifiedJunctions;
+		vector<Element*> ModifiedElements;
+		// Open transaction
+		struct Rewiring {
+			Element* Elem;
+			ModifiedState Prior;
+		};
+		struct Link {
+			Port* Prt;
+			Junction* Jnt;
+		};
+		struct Undo {
+			SettingsData* Schema;
+			int Instance;
+			SettingKey Key;
+			size_t Offset;
+		};
+		Mode CalcMode = Mode::INTERACTIVE;
+		double Frequency = 50;
+		double RatedFrequency = 50;
+		vector<Rewiring> PendingTopology;
+		vector<Link> PendingConnections;
+		vector<Undo> UndoLog;
+		vector<char> UndoData;
+		// Nodal admittance matrix and injection, Y = T * SIGMA, R = -T * J
+		CSM Y;
+		CV R;
+		CV V;
+		CV I;
+		bool CurrentsReady = false;
+		// Terminal DOF to conductor DOF, T in index form, -1 for unused terminal DOFs
+		vector<int> Incidence;
+		// Voltage DOFs left by moved or shrunk junctions, decoupled by a unit diagonal
+		vector<char> Spare;
+		vector<int> Spares;
+		vector<int> SpareSlots;
+		int VDOFS = 0;
+		int IDOFS = 0;
+		// Persistent factorization, symbolic part kept between topology changes
+		CSLU Solver;
+		// Valid numeric factorization of the current values
+		bool Factorized = false;
+		bool Singular = false;
+		// Assembled state counter, lets derived solvers detect any change since their build
+		int Revision = 0;
+		// Revision solved into V, nodal voltages are stale while it differs
+		int Solution = -1;
+		// Topology counter, DOF numbering and pattern are unchanged while it holds
+		int Layout = 0;
+		// Delta stampings since the last full one, bounds the cancellation error they accumulate
+		static const int RestampPeriod = 64;
+		int Deltas = 0;
+		// Restored pattern and column ordering, consumed by the next topology assembly
+		bool PatternReady = false;
+		vector<int> Ordering;
 	};
 }
 
@@ -0,0 +1,47 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+#include <deque>
+#include "topology.hpp"
+
+// Contiguous storage of elements by concrete type
+
+namespace utilsim
+{
+	// Type-erased interface used by the network
+	class PoolBase {
+	public:
+		virtual ~PoolBase() {}
+		// Model refresh of modified elements, all of the pool type
+		virtual void update(const vector<Element*>& modified) = 0;
+		// Stamping of all elements
+		virtual void fill(CSM& Y, CV& R) = 0;
+	};
+
+	template<class T> class Pool : public PoolBase {
+	public:
+		// Chunked storage - addresses stay valid while growing
+		T* insert(NID* id) {
+			Items.emplace_back(id);
+			return &Items.back();
+		}
+		// Settings capacity for upcoming insertions
+		void reserve(int count) {
+			T::SD.reserve(count);
+		}
+		void update(const vector<Element*>& modified) {
+			// Qualified call - no virtual dispatch inside the batch
+			for (auto elem : modified) {
+				static_cast<T*>(elem)->T::updateModel();
+			}
+		}
+		void fill(CSM& Y, CV& R) {
+			for (auto& elem : Items) {
+				elem.fill(Y, R);
+			}
+		}
+	private:
+		deque<T> Items;
+	};
+}
+
+#endif
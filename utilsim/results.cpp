@@ -0,0 +1,104 @@
+#include <algorithm>
+#include "results.hpp"
+
+namespace utilsim
+{
+	// SPAN ==============================================================
+
+	CSpan::CSpan(const CPX* data, int size) : Data(data), Size(size) {
+
+	}
+
+	CPX CSpan::operator[](int i) const {
+		return Data[i];
+	}
+
+	const CPX* CSpan::data() const {
+		return Data;
+	}
+
+	int CSpan::size() const {
+		return Size;
+	}
+
+	const CPX* CSpan::begin() const {
+		return Data;
+	}
+
+	const CPX* CSpan::end() const {
+		return Data + Size;
+	}
+
+	// JUNCTION VIEW =====================================================
+
+	JunctionView::JunctionView(Junction* jnt, CV& v) : Target(jnt), V(&v) {
+
+	}
+
+	int JunctionView::size() {
+		return Target->countConductors();
+	}
+
+	CPX JunctionView::voltage(int k) {
+		return (*V)[Target->getFirstDOF() + k];
+	}
+
+	CSpan JunctionView::voltages() {
+		// Live conductors are numbered consecutively
+		return CSpan(V->data() + Target->getFirstDOF(), size());
+	}
+
+	// ELEMENT VIEW ======================================================
+
+	ElementView::ElementView(Element* elem, CV& v) : Target(elem), V(&v) {
+
+	}
+
+	int ElementView::size() {
+		return (int)Target->getNodes().size();
+	}
+
+	CPX ElementView::voltage(int i) {
+		return (*V)[Target->getNodes()[i]];
+	}
+
+	CPX ElementView::current(int i) {
+		// Row i of the stamp, column-major storage
+		vector<int>& nodes = Target->getNodes();
+		CDM& S = Target->getS();
+		const CPX* s = S.data();
+		int n = S.rows();
+		if (nodes.empty()) {
+			// Open element carries no current
+			return CPX(0, 0);
+		}
+		CPX val = Target->getJ()[i];
+		for (int j = 0; j < n; j++) {
+			val += s[i + j * n] * (*V)[nodes[j]];
+		}
+		return val;
+	}
+
+	void ElementView::currents(CPX* out) {
+		vector<int>& nodes = Target->getNodes();
+		CDM& S = Target->getS();
+		CV& J = Target->getJ();
+		const CPX* s = S.data();
+		int n = S.rows();
+		if (nodes.empty()) {
+			// Open element carries no current
+			fill(out, out + n, CPX(0, 0));
+			return;
+		}
+		for (int i = 0; i < n; i++) {
+			out[i] = J[i];
+		}
+		// Column sweep over contiguous stamp storage
+		for (int j = 0; j < n; j++) {
+			CPX v = (*V)[nodes[j]];
+			for (int i = 0; i < n; i++) {
+				out[i] += s[i + j * n] * v;
+			}
+		}
+	}
+}
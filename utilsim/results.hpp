@@ -0,0 +1,50 @@
+#ifndef RESULTS_HPP
+#define RESULTS_HPP
+#include "topology.hpp"
+
+// Views over the network solution, nothing is copied
+
+namespace utilsim
+{
+	// Read-only contiguous range, valid until the next calculation
+	class CSpan {
+	public:
+		CSpan(const CPX* data = nullptr, int size = 0);
+		CPX operator[](int i) const;
+		const CPX* data() const;
+		int size() const;
+		const CPX* begin() const;
+		const CPX* end() const;
+	private:
+		const CPX* Data;
+		int Size;
+	};
+
+	// Conductor voltages of a junction, live conductors in handle order
+	class JunctionView {
+	public:
+		JunctionView(Junction* jnt, CV& V);
+		int size();
+		CPX voltage(int k);
+		CSpan voltages();
+	private:
+		Junction* Target;
+		CV* V;
+	};
+
+	// Terminal quantities of an element in port order, currents I = S * V + J on demand
+	class ElementView {
+	public:
+		ElementView(Element* elem, CV& V);
+		int size();
+		CPX voltage(int i);
+		CPX current(int i);
+		// All terminal currents, out holds size() values
+		void currents(CPX* out);
+	private:
+		Element* Target;
+		CV* V;
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "scenario.hpp"
+#include <mutex>
+
+namespace utilsim
+{
+	// Forks of a base that is not frozen yet wait while the first one prepares it
+	static mutex Forking;
+
+	Scenario::Scenario(Network* base) : Base(base), Y(CSM(0, 0)), R(CV::zeros(0)), V(CV::zeros(0)) {
+		// Frozen base values are the starting point over its pattern
+		{
+			lock_guard<mutex> lock(Forking);
+			Base->freeze();
+		}
+		Y.share(Base->Y);
+		R = Base->R;
+		V = Base->V;
+		Solved = Base->Factorized;
+	}
+
+	Scenario::~Scenario() {
+		for (auto& cp : Copies) {
+			delete cp.second.Elem;
+		}
+	}
+
+	bool Scenario::write(Element* target, const SettingKey& key, void* value) {
+		// Port rewiring would modify shared junctions
+		if (!target->SDR->owns(key) || key.Topological) {
+			return false;
+		}
+		Copy& cp = Copies[target];
+		if (cp.Elem == nullptr) {
+			cp.Elem = target->clone();
+		}
+		unsigned char status = cp.Elem->SDR->setValue<char>(cp.Elem->SET, key, value);
+		if ((status & (1 << (int)SettingStatus::Modified)) && !cp.Pending) {
+			cp.Pending = true;
+			Pending.push_back(target);
+		}
+		return true;
+	}
+
+	void Scenario::read(Element* target, const SettingKey& key, void* value) {
+		auto it = Copies.find(target);
+		Element* elem = it == Copies.end() ? target : it->second.Elem;
+		elem->SDR->getValue<char>(elem->SET, key, value);
+	}
+
+	bool Scenario::compute() {
+		if (Pending.empty()) {
+			// Unmodified since the last calculation, solution holds
+			return Solved;
+		}
+		// Delta stamping in private values, base element or earlier copy stamp is withdrawn
+		// before the copy model is refreshed, then the new stamp is added
+		bool restamp = ++Deltas >= Network::RestampPeriod;
+		// Copies grouped by kind, models are refreshed by one batch per kind
+		map<type_index, vector<Element*>> batches;
+		for (auto elem : Pending) {
+			Copy& cp = Copies[elem];
+			if (!restamp) {
+				(cp.Stamped ? cp.Elem : elem)->unfill(Y, R);
+			}
+			batches[typeid(*elem)].push_back(cp.Elem);
+		}
+		for (auto& batch : batches) {
+			// Lookup only, the base kinds are shared by concurrent scenarios
+			Base->Kinds.find(batch.first)->second.Storage->update(batch.second);
+		}
+		for (auto elem : Pending) {
+			Copy& cp = Copies[elem];
+			if (!restamp) {
+				cp.Elem->stamp(Y, R);
+			}
+			cp.Stamped = true;
+			cp.Pending = false;
+		}
+		Pending.clear();
+		if (restamp) {
+			// Periodic full stamp of the base elements and the copies, clears the accumulated drift
+			// Shared base elements are only read, their state belongs to the base network
+			Y.setZero();
+			R.setZero();
+			for (auto elem : Base->Elements) {
+				auto it = Copies.find(elem);
+				(it == Copies.end() || !it->second.Stamped ? elem : it->second.Elem)->stamp(Y, R);
+			}
+			Y.addValue(Base->SpareSlots, CPX(1, 0));
+			Deltas = 0;
+		}
+		// Symbolic analysis with the base ordering, no fill-reducing search
+		if (!Solver.isAnalyzed()) {
+			Solver.analyze(Y, Base->Solver.getOrdering());
+		}
+		Solved = Solver.factorize(Y);
+		if (!Solved) {
+			return false;
+		}
+		V = Solver.solve(R);
+		return true;
+	}
+
+	CV& Scenario::getVoltages() {
+		return V;
+	}
+
+	JunctionView Scenario::view(Junction* jnt) {
+		return JunctionView(jnt, V);
+	}
+
+	ElementView Scenario::view(Element* elem) {
+		auto it = Copies.find(elem);
+		return ElementView(it == Copies.end() ? elem : it->second.Elem, V);
+	}
+
+	int Scenario::countModified() {
+		return (int)Copies.size();
+	}
+}
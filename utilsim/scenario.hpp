@@ -0,0 +1,67 @@
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+#include <unordered_map>
+#include "network.hpp"
+
+// Copy-on-write what-if scenarios
+
+namespace utilsim
+{
+	class Scenario {
+		/*	Fork of an assembled network
+			Shared with the base: junctions, unmodified elements with their stamps and settings,
+			pattern and column ordering of the nodal matrix.
+			Private: copies of modified elements, nodal values and numeric factorization.
+			Scenarios of one base may be created, edited and computed on different threads,
+			the base is frozen by the first of them (see Network::freeze) and is expected
+			to stay unchanged while they exist.
+			Element copies are not attached to the library Record of their base element,
+			record edits made after the fork do not reach them.
+		*/
+	public:
+		Scenario(Network* base);
+		~Scenario();
+		// Parametric settings only, false for unknown or topological settings
+		template<class T> bool setValue(Element* target, const char* name, void* value) {
+			return write(target, target->getKey(name), value);
+		}
+		template<class T> bool setValue(Element* target, const SettingKey& key, void* value) {
+			return write(target, key, value);
+		}
+		template<class T> void getValue(Element* target, const char* name, void* value) {
+			read(target, target->getKey(name), value);
+		}
+		template<class T> void getValue(Element* target, const SettingKey& key, void* value) {
+			read(target, key, value);
+		}
+		// False on a singular scenario network
+		bool compute();
+		// Solution of the scenario, the base one until the first modification
+		CV& getVoltages();
+		JunctionView view(Junction* jnt);
+		ElementView view(Element* elem);
+		int countModified();
+	private:
+		struct Copy {
+			Element* Elem = nullptr;
+			// Stamp of the copy replaced the base one in Y and R
+			bool Stamped = false;
+			bool Pending = false;
+		};
+		bool write(Element* target, const SettingKey& key, void* value);
+		void read(Element* target, const SettingKey& key, void* value);
+		Network* Base;
+		unordered_map<Element*, Copy> Copies;
+		// Base elements with copies awaiting model update
+		vector<Element*> Pending;
+		CSM Y;
+		CV R;
+		CV V;
+		CSLU Solver;
+		bool Solved = false;
+		// Delta stampings since the last full one, restamped with the base period
+		int Deltas = 0;
+	};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "settings.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
 
 namespace utilsim
 {
@@ -9,6 +10,10 @@ namespace utilsim
 
 	SettingsData::SettingsData(const char* kind) {
 		Default = nullptr;
+		Bytes = 0;
+		Instances = 0;
+		Capacity = 0;
+		Growth = unique_ptr<mutex>(new mutex());
 		Kind = kind;
 		Data = vector<Meta>();
 	}
@@ -16,8 +21,8 @@ namespace utilsim
 	void SettingsData::insertEnumSetting(const char* name, size_t size[2], bool topo, vector<const char*> enumVals, const char* default_value) {
 		// Converting char default to int
 		int defval = 0;
-		for (int k = 0; k < enumVals.size(); k++) {
-			if (enumVals[k] == default_value) {
+		for (int k = 0; k < (int)enumVals.size(); k++) {
+			if (!strcmp(enumVals[k], default_value)) {
 				defval = k;
 				break;
 			}
@@ -29,10 +34,89 @@ namespace utilsim
 		Data.rbegin()->EnumValues = enumVals;
 	}
 
-	void* SettingsData::getInstance() {
-		void* res = malloc(Bytes);
-		memcpy(res, Default, Bytes);		
-		return res;
+	int SettingsData::getInstance() {
+		lock_guard<mutex> guard(*Growth);
+		return allocate();
+	}
+
+	int SettingsData::allocate() {
+		// Reusing released slot if any
+		int inst;
+		if (!Released.empty()) {
+			inst = Released.back();
+			Released.pop_back();
+		}
+		else {
+			if (!grow(Instances + 1)) {
+				return -1;
+			}
+			inst = Instances++;
+		}
+		// Defaults
+		for (int k = 0; k < (int)Data.size(); k++) {
+			memcpy(slot(k, inst), static_cast<char*>(Default) + Data[k].Position, Data[k].Bytes);
+		}
+		return inst;
+	}
+
+	bool SettingsData::grow(int count) {
+		if (count > (BlockLimit << BlockShift)) {
+			return false;
+		}
+		// Whole blocks, instances already handed out keep their addresses
+		for (; Capacity < count; Capacity += 1 << BlockShift) {
+			for (auto& col : Columns) {
+				col.Blocks[Capacity >> BlockShift].reset(new char[col.Bytes << BlockShift]);
+			}
+		}
+		return true;
+	}
+
+	int SettingsData::cloneInstance(int inst) {
+		lock_guard<mutex> guard(*Growth);
+		int copy = allocate();
+		if (copy < 0) {
+			return copy;
+		}
+		for (int k = 0; k < (int)Data.size(); k++) {
+			memcpy(slot(k, copy), slot(k, inst), Data[k].Bytes);
+		}
+		return copy;
+	}
+
+	void SettingsData::releaseInstance(int inst) {
+		lock_guard<mutex> guard(*Growth);
+		Released.push_back(inst);
+	}
+
+	void SettingsData::reserve(int count) {
+		lock_guard<mutex> guard(*Growth);
+		grow(min(Instances + count, BlockLimit << BlockShift));
+	}
+
+	unsigned char SettingsData::setValues(const SettingKey& key, const int* instances, const void* values, int count, vector<int>& modified) {
+		// Consistency check, keys of another schema are rejected
+		if (!owns(key)) { return 1U << (int)SettingStatus::Unknown; }
+		unsigned char status = key.Topological << (int)SettingStatus::Topology;
+
+		const char* val = static_cast<const char*>(values);
+		for (int k = 0; k < count; k++) {
+			char* setPtr = slot(key.Index, instances[k]);
+			// Trivial rewrite check
+			if (memcmp(setPtr, val, key.Bytes)) {
+				memcpy(setPtr, val, key.Bytes);
+				modified.push_back(k);
+			}
+			val += key.Bytes;
+		}
+		if (!modified.empty()) {
+			status = status | (1U << (int)SettingStatus::Modified);
+		}
+		return status;
+	}
+
+	const char* SettingsData::getKind() {
+		return Kind;
 	}
 
 	vector<const char*> SettingsData::getNames() {
@@ -45,22 +129,107 @@ namespace utilsim
 	}
 
 	const char* SettingsData::decodeEnum(const char* setName, int val) {
-		for (auto& s : Data) {
-			if (setName == s.Name) {
-				return s.EnumValues[val];
+		int ns = getIndex(setName);
+		if (ns == -1 || val < 0 || val >= (int)Data[ns].EnumValues.size()) {
+			return nullptr;
+		}
+		return Data[ns].EnumValues[val];
+	}
+
+	int SettingsData::encodeEnum(const char* setName, const char* enumVal) {
+		// Returns -1 if not found
+		int ns = getIndex(setName);
+		if (ns == -1) {
+			return -1;
+		}
+		for (int k = 0; k < (int)Data[ns].EnumValues.size(); k++) {
+			if (!strcmp(Data[ns].EnumValues[k], enumVal)) {
+				return k;
+			}
+		}
+		return -1;
+	}
+
+	bool SettingsData::parseValue(const SettingKey& key, const vector<string>& tokens, void* value) {
+		if (!owns(key)) {
+			return false;
+		}
+		Meta& meta = Data[key.Index];
+		if (tokens.size() != meta.Size[0] * meta.Size[1]) {
+			return false;
+		}
+		char* out = static_cast<char*>(value);
+		for (auto& tok : tokens) {
+			const char* str = tok.c_str();
+			char* end = nullptr;
+			if (!meta.EnumValues.empty()) {
+				// Enum by name
+				int code = -1;
+				for (int k = 0; k < (int)meta.EnumValues.size(); k++) {
+					if (!strcmp(meta.EnumValues[k], str)) {
+						code = k;
+						break;
+					}
+				}
+				if (code == -1) {
+					return false;
+				}
+				memcpy(out, &code, sizeof(int));
+				out += sizeof(int);
+				continue;
+			}
+			if (meta.Type == typeid(float)) {
+				float val = strtof(str, &end);
+				memcpy(out, &val, sizeof(float));
+				out += sizeof(float);
+			}
+			else if (meta.Type == typeid(double)) {
+				double val = strtod(str, &end);
+				memcpy(out, &val, sizeof(double));
+				out += sizeof(double);
+			}
+			else if (meta.Type == typeid(int)) {
+				int val = (int)strtol(str, &end, 10);
+				memcpy(out, &val, sizeof(int));
+				out += sizeof(int);
+			}
+			else {
+				return false;
+			}
+			if (end == str || *end != '\0') {
+				return false;
 			}
 		}
-		return nullptr;
+		return true;
 	}
 
-	void SettingsData::print(void* s) {
+	SettingKey SettingsData::getKey(const char* name) {
+		SettingKey key;
+		int ns = getIndex(name);
+		if (ns != -1) {
+			key.Owner = this;
+			key.Index = ns;
+			key.Position = Data[ns].Position;
+			key.Bytes = Data[ns].Bytes;
+			key.Topological = Data[ns].Topological;
+			key.Type = &Data[ns].Type;
+		}
+		return key;
+	}
+
+	bool SettingsData::owns(const SettingKey& key) const {
+		return key.Owner == this && key.Index >= 0 && key.Index < (int)Data.size();
+	}
+
+	void SettingsData::print(int inst) {
 		cout << "--- " << Kind << " ---" << endl;
 		//int idx_scalar, idx_array;
 		//idx_scalar = idx_array = 0;
-		for (auto& M : Data) {
+		for (int k = 0; k < (int)Data.size(); k++) {
+			Meta& M = Data[k];
 			cout << M.Name << ": ";
 			// Data
-			void* set = static_cast<char*>(s) + M.Position;
+			void* set = slot(k, inst);
 
 			if (M.Type == typeid(float)) {
 				printSetting<float>(set, M.Size[0], M.Size[1]);
@@ -78,16 +247,13 @@ namespace utilsim
 		}
 	}
 
-	size_t SettingsData::getIndex(const char* sname) {
+	int SettingsData::getIndex(const char* sname) {
 		// Returns -1 if not found
-		size_t idx = 0;
-		for (auto& M : Data) {			
-			if (M.Name == sname) {
-				return idx;
-			}
-			idx++;			
+		auto it = Lookup.find(sname);
+		if (it == Lookup.end()) {
+			return -1;
 		}
-		return -1;
+		return it->second;
 	}
 
 }
\ No newline at end of file
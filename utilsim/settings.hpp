@@ -2,6 +2,12 @@
 #define SETTINGS_HPP
 #include <vector>
 #include <iostream>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 
 // Extendable element settings configurator
 
@@ -10,6 +16,19 @@ namespace utilsim
 {
 	enum class SettingStatus {Unknown, Modified, Topology};
 
+	class SettingsData;
+
+	// Resolved setting handle, valid for the SettingsData that produced it
+	struct SettingKey {
+		const SettingsData* Owner = nullptr;
+		int Index = -1;
+		size_t Position = 0;
+		size_t Bytes = 0;
+		bool Topological = false;
+		// Entry type, enum settings are stored as int
+		const type_info* Type = nullptr;
+	};
+
 	class SettingsData {
 	private:
 		const char* Kind;
@@ -23,17 +42,36 @@ namespace utilsim
 			size_t Bytes;
 		};
 		vector<Meta> Data;
+		// Name to index, names are expected to have static storage
+		unordered_map<string_view, int> Lookup;
 		void* Default;
 		size_t Bytes;
+		// Instance storage, one column per setting in blocks of consecutive instances
+		// Blocks never move, values are accessed without locking from any network
+		static const int BlockShift = 12;
+		static const int BlockLimit = 4096;
+		struct Column {
+			size_t Bytes;
+			// BlockLimit entries, a block is allocated before its first instance is handed out
+			unique_ptr<unique_ptr<char[]>[]> Blocks;
+		};
+		vector<Column> Columns;
+		vector<int> Released;
+		int Instances;
+		int Capacity;
+		// Instance allocation and release of this schema
+		unique_ptr<mutex> Growth;
 	public:
 		SettingsData(const char* kind);
 
-		// General-purpose
+		// General-purpose, settings are inserted while the schema is defined, before instances are shared
 		template <class T> void insertSetting(const char* name, size_t size[2], bool topo, void* default_value) {
+			lock_guard<mutex> guard(*Growth);
 			// Extending metadata
 			vector<const char*> enumVals = vector<const char*>(0);
 			size_t settingBytes = sizeof(T) * size[0] * size[1];
 			Data.push_back({ typeid(T), name, {size[0],size[1]}, topo, enumVals, Bytes, settingBytes });
+			Lookup[name] = (int)Data.size() - 1;
 			// Building extended storage
 			void* newData = malloc(Bytes + settingBytes);
 			memcpy(newData, Default, Bytes);
@@ -43,55 +81,93 @@ namespace utilsim
 			// Saving	
 			Default = newData;
 			Bytes += settingBytes;
+
+			// Extending existing instances with default value
+			Columns.push_back({ settingBytes, unique_ptr<unique_ptr<char[]>[]>(new unique_ptr<char[]>[BlockLimit]) });
+			for (int b = 0; b < (Capacity >> BlockShift); b++) {
+				Columns.back().Blocks[b].reset(new char[settingBytes << BlockShift]);
+			}
+			for (int k = 0; k < Instances; k++) {
+				memcpy(slot((int)Columns.size() - 1, k), default_value, settingBytes);
+			}
 		}
 
 		// Enum-targeted
 		void insertEnumSetting(const char* name, size_t size[2], bool topo, vector<const char*> enumVals, const char* default_value);
 
 		// SetGet
+		const char* getKind();
 		vector<const char*> getNames();
 
 		const char* decodeEnum(const char* setName, int enumVal);
+		int encodeEnum(const char* setName, const char* enumVal);
+		// Text conversion by schema type, one token per entry (enum names for enum settings); value holds key.Bytes
+		bool parseValue(const SettingKey& key, const vector<string>& tokens, void* value);
+
+		// Handle resolution, once per caller - O(1) access afterwards
+		SettingKey getKey(const char* name);
+		bool owns(const SettingKey& key) const;
 
-		template <class T> unsigned char setValue(void* data, const char* name, void* value) {
-			// Consistency check
-			int ns = getIndex(name);
-			if (ns == -1) { return 1U << (int)SettingStatus::Unknown; }
-			unsigned char status = Data[ns].Topological << (int)SettingStatus::Topology;
+		template <class T> unsigned char setValue(int inst, const SettingKey& key, void* value) {
+			// Consistency check, keys of another schema are rejected
+			if (!owns(key)) { return 1U << (int)SettingStatus::Unknown; }
+			unsigned char status = key.Topological << (int)SettingStatus::Topology;
 
 			// Trivial rewrite check
-			void* setPtr = static_cast<char*>(data) + Data[ns].Position;
-			if (!memcmp(setPtr, value, Data[ns].Bytes)) {
+			void* setPtr = slot(key.Index, inst);
+			if (!memcmp(setPtr, value, key.Bytes)) {
 				return status;
 			}
-			status = status & (1U << (int)SettingStatus::Modified);
+			status = status | (1U << (int)SettingStatus::Modified);
 
 			// Finally assigning value
-			memcpy(setPtr, value, Data[ns].Bytes);
+			memcpy(setPtr, value, key.Bytes);
 			return status;
 		}
 
-		template <class T> unsigned char getValue(void* data, const char* name, void* value) {
-			// Consistency check
-			int ns = getIndex(name);
-			if (ns == -1) { return 1U << (int)SettingStatus::Unknown; }
-			unsigned char status = Data[ns].Topological << (int)SettingStatus::Topology;
+		template <class T> unsigned char getValue(int inst, const SettingKey& key, void* value) {
+			// Consistency check, keys of another schema are rejected
+			if (!owns(key)) { return 1U << (int)SettingStatus::Unknown; }
+			unsigned char status = key.Topological << (int)SettingStatus::Topology;
 			// Reading
-			memcpy(value, static_cast<char*>(data) + Data[ns].Position, Data[ns].Bytes);
+			memcpy(value, slot(key.Index, inst), key.Bytes);
 			return status;
 		}
 
-		// Factory
-		void* getInstance();
+		// Interactive access by name
+		template <class T> unsigned char setValue(int inst, const char* name, void* value) {
+			return setValue<T>(inst, getKey(name), value);
+		}
+
+		template <class T> unsigned char getValue(int inst, const char* name, void* value) {
+			return getValue<T>(inst, getKey(name), value);
+		}
+
+		// Direct typed access to instance storage
+		template <class T> T* at(int inst, const SettingKey& key) {
+			return reinterpret_cast<T*>(slot(key.Index, inst));
+		}
+
+		// Bulk update, values[k] goes to instances[k]; indices k of modified entries are appended
+		unsigned char setValues(const SettingKey& key, const int* instances, const void* values, int count, vector<int>& modified);
+
+		// Factory, at most BlockLimit << BlockShift live instances (-1 beyond, element and record
+		// constructors turn it into length_error)
+		int getInstance();
+		// New instance with the values of inst
+		int cloneInstance(int inst);
+		void releaseInstance(int inst);
+		// Blocks for additional instances, allocated ahead of inserting them
+		void reserve(int count);
 
 		// Debug
-		void print(void* s);
+		void print(int inst);
 		template <class T> void printSetting(void* data, size_t rows, size_t cols) {
 			T* castedData = (T*)data;
 			cout << "[";
-			for (int k = 0; k < rows; k++) {
+			for (size_t k = 0; k < rows; k++) {
 				cout << "[";
-				for (int m = 0; m < cols; m++) {
+				for (size_t m = 0; m < cols; m++) {
 					// Float
 					cout << *(castedData++) << " ";
 				}
@@ -103,7 +179,14 @@ namespace utilsim
 			cout << "]" << endl;
 		}
 	private:
-		size_t getIndex(const char* name);
+		int getIndex(const char* name);
+		int allocate();
+		// Blocks for the first count instances, caller holds Growth
+		bool grow(int count);
+		char* slot(int index, int inst) {
+			Column& col = Columns[index];
+			return col.Blocks[inst >> BlockShift].get() + (size_t)(inst & ((1 << BlockShift) - 1)) * col.Bytes;
+		}
 	};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "shortcircuit.hpp"
+
+namespace utilsim
+{
+	ShortCircuit::ShortCircuit(Network* net) {
+		Net = net;
+	}
+
+	void ShortCircuit::setImpedance(CPX zf) {
+		Zf = zf;
+	}
+
+	vector<Fault>& ShortCircuit::getResults() {
+		return Results;
+	}
+
+	bool ShortCircuit::run() {
+		Results.clear();
+		// Pre-fault network, assembled without the load flow factorization
+		Net->commit();
+		Net->assemble(false);
+		if (Analyzed != Net->Layout) {
+			Blocks.clear();
+			Blocks.reserve(Net->Junctions.size());
+			for (auto jnt : Net->Junctions) {
+				Blocks.emplace_back();
+				for (int k = 0; k < min(3, jnt->countConductors()); k++) {
+					Blocks.back().push_back(jnt->getFirstDOF() + k);
+				}
+			}
+			// Junction blocks of the inverse, no solve per junction
+			Solver.analyze(Net->Y, Blocks);
+			Analyzed = Net->Layout;
+			Factored = -1;
+		}
+		if (Factored != Net->Revision) {
+			if (!Solver.factorize(Net->Y)) {
+				Factored = -1;
+				return false;
+			}
+			V = Solver.solve(Net->R);
+			Solver.invert();
+			Factored = Net->Revision;
+		}
+
+		Results.reserve(Blocks.size());
+		for (size_t b = 0; b < Blocks.size(); b++) {
+			vector<int>& dofs = Blocks[b];
+			int k = (int)dofs.size();
+			Results.push_back({ Net->Junctions[b], false, CDM(k, k), CV::zeros(k), CV::zeros(k) });
+			Fault& out = Results.back();
+			CDM Z = CDM(k, k);
+			CDM Vb = CDM(k, 1);
+			for (int i = 0; i < k; i++) {
+				for (int j = 0; j < k; j++) {
+					out.Impedance(i, j) = Solver.inverse(dofs[i], dofs[j]);
+					Z(i, j) = out.Impedance(i, j);
+				}
+				Z(i, i) += Zf;
+				Vb(i, 0) = V[dofs[i]];
+				out.SingleLine[i] = Vb(i, 0) / Z(i, i);
+			}
+			if (k == 0) {
+				continue;
+			}
+			if (Z.rank(1e-9) < k) {
+				out.Singular = true;
+				continue;
+			}
+			CDM I = Z | Vb;
+			for (int i = 0; i < k; i++) {
+				out.ThreePhase[i] = I(i, 0);
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef SHORTCIRCUIT_HPP
+#define SHORTCIRCUIT_HPP
+#include "network.hpp"
+
+// Short-circuit analysis at every junction
+
+namespace utilsim
+{
+	// Fault currents of one junction, phases are the first three live conductors
+	struct Fault {
+		Junction* Target;
+		// Fault impedance block is singular, no finite current
+		bool Singular;
+		// Junction block of the impedance matrix Y^-1, fault impedance not included
+		CDM Impedance;
+		// Phase currents of a three-phase fault to ground
+		CV ThreePhase;
+		// Fault current of a single line to ground fault per phase
+		CV SingleLine;
+	};
+
+	class ShortCircuit {
+		/*	Fault as a low-rank modification of the pre-fault network
+			I_f = (Z_bb + Z_f)^-1 * V_b
+			where:
+			Z_bb - junction block of Y^-1, all blocks from one factorization by selected inversion
+			Z_f - fault impedance per phase to ground
+			V_b - pre-fault conductor voltages of the junction, solved with the same factors
+		*/
+	public:
+		ShortCircuit(Network* net);
+		void setImpedance(CPX zf);
+		// Every junction, pre-fault state from the current network settings, false on a singular network
+		bool run();
+		vector<Fault>& getResults();
+	private:
+		Network* Net;
+		CPX Zf = 0;
+		// Analysis kept per network layout, factors and inverse per network revision
+		CSLDU Solver;
+		vector<vector<int>> Blocks;
+		int Analyzed = -1;
+		int Factored = -1;
+		CV V;
+		vector<Fault> Results;
+	};
+}
+
+#endif
@@ -0,0 +1,504 @@
+#include <fstream>
+#include <typeindex>
+#include <unordered_map>
+#include "snapshot.hpp"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utilsim
+{
+	static const char SnapshotMagic[8] = { 'U','S','I','M','S','N','A','P' };
+
+	// Writing helpers ---------------------------------------------------
+
+	static void put(vector<char>& buf, const void* data, size_t bytes) {
+		const char* src = static_cast<const char*>(data);
+		buf.insert(buf.end(), src, src + bytes);
+	}
+
+	template<class T> static void put(vector<char>& buf, const T& val) {
+		put(buf, &val, sizeof(T));
+	}
+
+	static void align(vector<char>& buf) {
+		buf.resize((buf.size() + 7) & ~size_t(7), 0);
+	}
+
+	static void putText(vector<char>& buf, const char* str) {
+		// Zero terminated, usable in place after mapping
+		uint32_t len = (uint32_t)strlen(str);
+		put(buf, len);
+		put(buf, str, len + 1);
+		align(buf);
+	}
+
+	// Reading helpers ---------------------------------------------------
+
+	struct Cursor {
+		const char* Data;
+		size_t Size;
+		size_t Pos;
+	};
+
+	static bool fits(const Cursor& in, uint64_t count, size_t bytes) {
+		// Overflow free, the position may be past the end after padding
+		return in.Pos <= in.Size && count <= (in.Size - in.Pos) / bytes;
+	}
+
+	template<class T> static const T* take(Cursor& in, uint64_t count) {
+		if (!fits(in, count, sizeof(T))) {
+			return nullptr;
+		}
+		const T* val = reinterpret_cast<const T*>(in.Data + in.Pos);
+		in.Pos += sizeof(T) * count;
+		return val;
+	}
+
+	static void align(Cursor& in) {
+		in.Pos = (in.Pos + 7) & ~size_t(7);
+	}
+
+	static const char* takeText(Cursor& in) {
+		const uint32_t* len = take<uint32_t>(in, 1);
+		if (len == nullptr) {
+			return nullptr;
+		}
+		const char* str = take<char>(in, (uint64_t)*len + 1);
+		align(in);
+		return (str != nullptr && str[*len] == '\0') ? str : nullptr;
+	}
+
+	// SAVE ==============================================================
+
+	bool Snapshot::save(Network* net, const char* path, bool pattern) {
+		vector<char> buf;
+		vector<Element*>& elems = net->Elements;
+		vector<Junction*>& jnts = net->Junctions;
+
+		// Element kinds in order of first appearance
+		vector<SettingsData*> kinds;
+		vector<vector<int>> instances;
+		vector<uint32_t> elemKind(elems.size());
+		vector<uint32_t> elemRecord(elems.size());
+		unordered_map<Record*, uint32_t> recIndex;
+		for (size_t k = 0; k < net->Archive.size(); k++) {
+			recIndex[net->Archive[k]] = (uint32_t)k + 1;
+		}
+		for (size_t k = 0; k < elems.size(); k++) {
+			SettingsData* sd = elems[k]->getSettings();
+			size_t kind = 0;
+			while (kind < kinds.size() && kinds[kind] != sd) {
+				kind++;
+			}
+			if (kind == kinds.size()) {
+				kinds.push_back(sd);
+				instances.push_back(vector<int>());
+			}
+			instances[kind].push_back(elems[k]->getInstance());
+			elemKind[k] = (uint32_t)kind;
+			// Default records are not archived
+			auto rec = recIndex.find(elems[k]->getRecord());
+			elemRecord[k] = rec == recIndex.end() ? 0 : rec->second;
+		}
+
+		// Stored pattern must describe the current topology
+		if (pattern) {
+			pattern = net->Solver.isAnalyzed() && net->Y.rows() == net->VDOFS && net->Spares.empty();
+			for (auto jnt : jnts) {
+				pattern = pattern && jnt->getState() != ModifiedState::TOPOLOGY;
+			}
+			for (auto elem : elems) {
+				pattern = pattern && elem->getState() != ModifiedState::TOPOLOGY;
+			}
+		}
+
+		// Header
+		SnapshotHeader head;
+		memcpy(head.Magic, SnapshotMagic, sizeof(head.Magic));
+		head.Version = Version;
+		head.Flags = pattern ? 1U << (int)SnapshotFlag::Pattern : 0;
+		head.Frequency = net->Frequency;
+		head.RatedFrequency = net->RatedFrequency;
+		head.Kinds = kinds.size();
+		head.Records = net->Archive.size();
+		head.Elements = elems.size();
+		head.Junctions = jnts.size();
+		put(buf, head);
+
+		// Kinds
+		for (auto sd : kinds) {
+			putText(buf, sd->getKind());
+			vector<const char*> names = sd->getNames();
+			put(buf, (uint64_t)names.size());
+			for (auto name : names) {
+				putText(buf, name);
+				put(buf, (uint64_t)sd->getKey(name).Bytes);
+			}
+		}
+
+		// Records
+		for (auto rec : net->Archive) {
+			SettingsData* sd = rec->getSettings();
+			putText(buf, sd->getKind());
+			vector<const char*> names = sd->getNames();
+			put(buf, (uint64_t)names.size());
+			for (auto name : names) {
+				SettingKey key = sd->getKey(name);
+				putText(buf, name);
+				put(buf, (uint64_t)key.Bytes);
+				put(buf, sd->at<char>(rec->getInstance(), key), key.Bytes);
+				align(buf);
+			}
+		}
+
+		// Elements
+		put(buf, elemKind.data(), elemKind.size() * sizeof(uint32_t));
+		align(buf);
+		put(buf, elemRecord.data(), elemRecord.size() * sizeof(uint32_t));
+		align(buf);
+
+		// Settings columns
+		for (size_t kind = 0; kind < kinds.size(); kind++) {
+			for (auto name : kinds[kind]->getNames()) {
+				SettingKey key = kinds[kind]->getKey(name);
+				for (auto inst : instances[kind]) {
+					put(buf, kinds[kind]->at<char>(inst, key), key.Bytes);
+				}
+				align(buf);
+			}
+		}
+
+		// Junctions, conductor handles are compacted over tombstones
+		unordered_map<Junction*, int32_t> jntIndex;
+		vector<vector<int32_t>> compact(jnts.size());
+		for (size_t k = 0; k < jnts.size(); k++) {
+			jntIndex[jnts[k]] = (int32_t)k;
+			int32_t live = 0;
+			for (auto& cond : jnts[k]->Conductors) {
+				compact[k].push_back(cond.Parent == nullptr ? -1 : live++);
+			}
+			put(buf, (uint32_t)live);
+		}
+		align(buf);
+
+		// Ports
+		for (auto elem : elems) {
+			for (int p = 0; p < elem->countPorts(); p++) {
+				Port* prt = elem->getPort(p);
+				auto jnt = jntIndex.find(prt->Connection);
+				int32_t j = jnt == jntIndex.end() ? -1 : jnt->second;
+				put(buf, j);
+				put(buf, (int32_t)prt->Terminals.size());
+				for (auto& term : prt->Terminals) {
+					put(buf, (j < 0 || term.Socket < 0) ? (int32_t)-1 : compact[j][term.Socket]);
+				}
+			}
+		}
+		align(buf);
+
+		// Pattern and ordering
+		if (pattern) {
+			CSM& Y = net->Y;
+			int32_t n = Y.rows();
+			int32_t nnz = Y.nonZeros();
+			vector<int> ordering = net->Solver.getOrdering();
+			put(buf, n);
+			put(buf, nnz);
+			put(buf, Y.outerIndex(), (n + 1) * sizeof(int));
+			put(buf, Y.innerIndex(), nnz * sizeof(int));
+			put(buf, (int32_t)ordering.size());
+			put(buf, ordering.data(), ordering.size() * sizeof(int));
+			align(buf);
+		}
+
+		// Output
+		ofstream file(path, ios::binary | ios::trunc);
+		file.write(buf.data(), buf.size());
+		return file.good();
+	}
+
+	// LOAD ==============================================================
+
+	bool Snapshot::load(Network* net, const char* path) {
+		// Memory mapped input, no intermediate copy
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(file, &size);
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const char* data = mapping != NULL ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		bool ok = data != nullptr && load(net, data, (size_t)size.QuadPart);
+		if (data != nullptr) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return ok;
+#else
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		void* data = MAP_FAILED;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		bool ok = data != MAP_FAILED && load(net, static_cast<const char*>(data), (size_t)st.st_size);
+		if (data != MAP_FAILED) {
+			munmap(data, st.st_size);
+		}
+		close(fd);
+		return ok;
+#endif
+	}
+
+	bool Snapshot::load(Network* net, const char* data, size_t size) {
+		if (!net->Elements.empty() || !net->Junctions.empty()) {
+			return false;
+		}
+		Cursor in = { data, size, 0 };
+
+		// Header
+		const SnapshotHeader* head = take<SnapshotHeader>(in, 1);
+		if (head == nullptr || memcmp(head->Magic, SnapshotMagic, sizeof(head->Magic)) || head->Version != Version) {
+			return false;
+		}
+		// Set before any element is inserted, models are built once at the stored frequencies
+		if (!(head->Frequency > 0) || !(head->RatedFrequency > 0)) {
+			return false;
+		}
+		net->setFrequency(head->Frequency);
+		net->setRatedFrequency(head->RatedFrequency);
+
+		// Every kind and record takes at least a name and a count, bounding the allocations below
+		if (head->Kinds + head->Records < head->Kinds || !fits(in, head->Kinds + head->Records, 16)) {
+			return false;
+		}
+
+		// Kinds
+		struct KindInfo {
+			const char* Name;
+			vector<const char*> Settings;
+			vector<uint64_t> Bytes;
+			vector<Element*> Members;
+		};
+		vector<KindInfo> kinds(head->Kinds);
+		for (auto& kind : kinds) {
+			kind.Name = takeText(in);
+			const uint64_t* count = take<uint64_t>(in, 1);
+			if (kind.Name == nullptr || count == nullptr) {
+				return false;
+			}
+			for (uint64_t k = 0; k < *count; k++) {
+				const char* name = takeText(in);
+				const uint64_t* bytes = take<uint64_t>(in, 1);
+				if (name == nullptr || bytes == nullptr) {
+					return false;
+				}
+				kind.Settings.push_back(name);
+				kind.Bytes.push_back(*bytes);
+			}
+		}
+
+		// Records
+		vector<Record*> records(head->Records);
+		for (auto& rec : records) {
+			const char* kind = takeText(in);
+			const uint64_t* count = take<uint64_t>(in, 1);
+			if (kind == nullptr || count == nullptr) {
+				return false;
+			}
+			rec = net->appendLibrary(kind);
+			for (uint64_t k = 0; k < *count; k++) {
+				const char* name = takeText(in);
+				const uint64_t* bytes = take<uint64_t>(in, 1);
+				const char* val = bytes != nullptr ? take<char>(in, *bytes) : nullptr;
+				if (name == nullptr || val == nullptr) {
+					return false;
+				}
+				align(in);
+				if (rec == nullptr) {
+					continue;
+				}
+				SettingKey key = rec->getKey(name);
+				if (key.Index != -1 && key.Bytes == *bytes) {
+					rec->setValue<char>(key, const_cast<char*>(val));
+				}
+			}
+		}
+
+		// Elements
+		const uint32_t* elemKind = take<uint32_t>(in, head->Elements);
+		align(in);
+		const uint32_t* elemRecord = take<uint32_t>(in, head->Elements);
+		align(in);
+		if (elemKind == nullptr || elemRecord == nullptr) {
+			return false;
+		}
+		vector<Element*> elems(head->Elements);
+		net->Elements.reserve(head->Elements);
+		for (size_t k = 0; k < elems.size(); k++) {
+			if (elemKind[k] >= kinds.size() || elemRecord[k] > records.size()) {
+				return false;
+			}
+			elems[k] = net->insertElement(kinds[elemKind[k]].Name);
+			if (elems[k] == nullptr) {
+				return false;
+			}
+			kinds[elemKind[k]].Members.push_back(elems[k]);
+			if (elemRecord[k] > 0 && records[elemRecord[k] - 1] != nullptr) {
+				elems[k]->link(records[elemRecord[k] - 1]);
+			}
+		}
+
+		// Settings columns, bulk update per kind (topological settings reconfigure ports)
+		for (auto& kind : kinds) {
+			for (size_t s = 0; s < kind.Settings.size(); s++) {
+				const char* column = take<char>(in, kind.Bytes[s] * kind.Members.size());
+				align(in);
+				if (column == nullptr) {
+					return false;
+				}
+				if (kind.Members.empty()) {
+					continue;
+				}
+				type_index ti = typeid(*kind.Members[0]);
+				SettingKey key = net->getKey(ti, kind.Settings[s]);
+				if (key.Index != -1 && key.Bytes == kind.Bytes[s]) {
+					net->setValues(ti, key, column);
+				}
+			}
+		}
+
+		// Junctions
+		const uint32_t* conductors = take<uint32_t>(in, head->Junctions);
+		align(in);
+		if (conductors == nullptr) {
+			return false;
+		}
+		net->reserve((int)head->Junctions);
+		vector<Junction*> jnts(head->Junctions);
+		for (auto& jnt : jnts) {
+			jnt = net->insertJunction();
+		}
+
+		// Ports, wired once per junction
+		vector<vector<Port*>> wiring(jnts.size());
+		vector<const int32_t*> sockets;
+		for (auto elem : elems) {
+			for (int p = 0; p < elem->countPorts(); p++) {
+				const int32_t* hdr = take<int32_t>(in, 2);
+				const int32_t* conds = (hdr != nullptr && hdr[1] >= 0) ? take<int32_t>(in, hdr[1]) : nullptr;
+				Port* prt = elem->getPort(p);
+				if (conds == nullptr || hdr[0] >= (int32_t)jnts.size() || hdr[1] != (int32_t)prt->Terminals.size()) {
+					return false;
+				}
+				sockets.push_back(conds);
+				if (hdr[0] >= 0) {
+					prt->Connection = jnts[hdr[0]];
+					wiring[hdr[0]].push_back(prt);
+				}
+			}
+		}
+		align(in);
+		for (size_t k = 0; k < jnts.size(); k++) {
+			jnts[k]->connectPorts(wiring[k].data(), (int)wiring[k].size());
+			// Only conductors that can hold a wired terminal are recreated, bounding corrupt counts
+			size_t terminals = 0;
+			for (auto prt : wiring[k]) {
+				terminals += prt->Terminals.size();
+			}
+			while (jnts[k]->Conductors.size() < min((size_t)conductors[k], terminals)) {
+				jnts[k]->createConductor();
+			}
+		}
+		// Non-default terminal mapping, fresh junctions have no tombstones
+		size_t pidx = 0;
+		for (auto elem : elems) {
+			for (int p = 0; p < elem->countPorts(); p++) {
+				Port* prt = elem->getPort(p);
+				const int32_t* conds = sockets[pidx++];
+				if (prt->Connection == nullptr) {
+					continue;
+				}
+				for (size_t t = 0; t < prt->Terminals.size(); t++) {
+					if (conds[t] >= 0 && prt->Terminals[t].Socket != conds[t]) {
+						prt->Connection->reconnectTerminal(&prt->Terminals[t], conds[t]);
+					}
+				}
+			}
+		}
+
+		// Pattern and ordering, used by the first assembly instead of a rebuild
+		if (head->Flags & (1U << (int)SnapshotFlag::Pattern)) {
+			const int32_t* dims = take<int32_t>(in, 2);
+			if (dims == nullptr || dims[0] < 0 || dims[1] < 0) {
+				return false;
+			}
+			const int* outer = take<int>(in, (uint64_t)dims[0] + 1);
+			const int* inner = outer != nullptr ? take<int>(in, dims[1]) : nullptr;
+			const int32_t* count = inner != nullptr ? take<int32_t>(in, 1) : nullptr;
+			const int* ordering = (count != nullptr && *count >= 0) ? take<int>(in, *count) : nullptr;
+			if (ordering == nullptr) {
+				return false;
+			}
+			// Inconsistent pattern is dropped, the first assembly rebuilds it
+			if (validPattern(dims[0], dims[1], outer, inner) && validOrdering(dims[0], *count, ordering)) {
+				net->Y = CSM(dims[0], dims[0]);
+				net->Y.setPattern(dims[1], outer, inner);
+				net->PatternReady = true;
+				net->Ordering.assign(ordering, ordering + *count);
+			}
+		}
+		return true;
+	}
+
+	bool Snapshot::validPattern(int dofs, int nnz, const int* outer, const int* inner) {
+		// Compressed columns with sorted, in range row indices
+		if (outer[0] != 0 || outer[dofs] != nnz) {
+			return false;
+		}
+		for (int j = 0; j < dofs; j++) {
+			if (outer[j + 1] < outer[j]) {
+				return false;
+			}
+			for (int p = outer[j]; p < outer[j + 1]; p++) {
+				if (inner[p] < 0 || inner[p] >= dofs || (p > outer[j] && inner[p] <= inner[p - 1])) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Snapshot::validOrdering(int dofs, int count, const int* ordering) {
+		// Empty or a permutation of the DOFs
+		if (count == 0) {
+			return true;
+		}
+		if (count != dofs) {
+			return false;
+		}
+		vector<bool> seen(dofs, false);
+		for (int k = 0; k < count; k++) {
+			if (ordering[k] < 0 || ordering[k] >= dofs || seen[ordering[k]]) {
+				return false;
+			}
+			seen[ordering[k]] = true;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+#include <cstdint>
+#include "network.hpp"
+
+// Binary network image for fast startup
+/*	Layout, native byte order, every block padded to 8 bytes:
+	header     - version, flags, analysis and rated frequency, block counts
+	kinds      - name, settings (name, bytes) per element kind
+	records    - kind name and raw settings per library record
+	elements   - kind index and record index + 1 per element
+	columns    - per kind and setting, values of all its elements in network order
+	junctions  - live conductor count per junction
+	ports      - per element port junction index (-1 free), terminal count and conductor indices
+	pattern    - optional, nodal matrix pattern and column ordering
+	Settings are matched by name on load, unknown ones are skipped
+	Pattern is checked on load and against the element stamps on first assembly, rebuilt if inconsistent
+*/
+
+namespace utilsim
+{
+	struct SnapshotHeader {
+		char Magic[8];
+		uint32_t Version;
+		uint32_t Flags;
+		// Analysis and rated frequency in Hz
+		double Frequency;
+		double RatedFrequency;
+		uint64_t Kinds;
+		uint64_t Records;
+		uint64_t Elements;
+		uint64_t Junctions;
+	};
+
+	enum class SnapshotFlag { Pattern };
+
+	class Snapshot {
+	public:
+		static const uint32_t Version = 2;
+		// Pattern is stored only when the network is assembled and has no pending topology change
+		static bool save(Network* net, const char* path, bool pattern = true);
+		// Target network is expected to be empty, it is left partially filled on failure
+		static bool load(Network* net, const char* path);
+	private:
+		static bool load(Network* net, const char* data, size_t size);
+		static bool validPattern(int dofs, int nnz, const int* outer, const int* inner);
+		static bool validOrdering(int dofs, int count, const int* ordering);
+	};
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include "sweep.hpp"
+
+namespace utilsim
+{
+	Sweep::Sweep(Network* net) {
+		Net = net;
+	}
+
+	void Sweep::addFrequency(double hz) {
+		Frequencies.push_back(hz);
+	}
+
+	void Sweep::addFrequencies(double first, double last, int count) {
+		for (int k = 0; k < count; k++) {
+			Frequencies.push_back(count > 1 ? first + (last - first) * k / (count - 1) : first);
+		}
+	}
+
+	void Sweep::addInjection(Junction* jnt, int conductor, const vector<CPX>& currents) {
+		Injections.push_back({ jnt, conductor, currents });
+	}
+
+	void Sweep::setSources(Emf points) {
+		Sources = points;
+	}
+
+	vector<double>& Sweep::getFrequencies() {
+		return Frequencies;
+	}
+
+	vector<CV>& Sweep::getResults() {
+		return Results;
+	}
+
+	void Sweep::run(int threads) {
+		Results.assign(Frequencies.size(), CV(0));
+		if (Frequencies.empty()) {
+			return;
+		}
+		if (threads <= 0) {
+			threads = max(1, (int)thread::hardware_concurrency());
+		}
+		threads = min(threads, (int)Frequencies.size());
+
+		// Topology and symbolic analysis once, at the network frequency
+		double base = Net->getFrequency();
+		Net->commit();
+		Net->assemble();
+		vector<int> ordering = Net->Solver.getOrdering();
+
+		// Symbolic analysis per worker on the calling thread, before any slot takes values
+		vector<CSLU> solvers(threads);
+		for (auto& solver : solvers) {
+			solver.analyze(Net->Y, ordering);
+		}
+
+		// Values only per point, the pattern stays with the network matrix
+		vector<Slot> slots(2 * threads);
+		for (auto& slot : slots) {
+			slot.Y.share(Net->Y);
+		}
+		mutex lock;
+		condition_variable readyCv, idleCv;
+		deque<int> ready, idle;
+		for (int k = 0; k < (int)slots.size(); k++) {
+			idle.push_back(k);
+		}
+		bool done = false;
+
+		// Workers factorize and solve handed over points
+		auto worker = [&](CSLU& solver) {
+			for (;;) {
+				unique_lock<mutex> guard(lock);
+				readyCv.wait(guard, [&]() { return !ready.empty() || done; });
+				if (ready.empty()) {
+					return;
+				}
+				int k = ready.front();
+				ready.pop_front();
+				Slot& slot = slots[k];
+				guard.unlock();
+				Results[slot.Point] = solver.factorize(slot.Y) ? solver.solve(slot.R) : CV(0);
+				guard.lock();
+				idle.push_back(k);
+				idleCv.notify_one();
+			}
+		};
+		vector<thread> pool;
+		for (int k = 0; k < threads; k++) {
+			pool.push_back(thread(worker, ref(solvers[k])));
+		}
+
+		// Serial model evaluation, overlapped with the factorization of earlier points
+		for (size_t p = 0; p < Frequencies.size(); p++) {
+			Net->setFrequency(Frequencies[p]);
+			Net->assemble(false);
+			unique_lock<mutex> guard(lock);
+			idleCv.wait(guard, [&]() { return !idle.empty(); });
+			int k = idle.front();
+			idle.pop_front();
+			guard.unlock();
+			Slot& slot = slots[k];
+			slot.Point = p;
+			slot.Y.copyValues(Net->Y);
+			bool emf = Sources == Emf::ALL || (Sources == Emf::FUNDAMENTAL && Frequencies[p] == Net->getRatedFrequency());
+			slot.R = emf ? Net->R : CV::zeros(Net->VDOFS);
+			for (auto& inj : Injections) {
+				if (p < inj.Currents.size() && inj.Conductor >= 0 && inj.Conductor < inj.Jnt->countConductors()) {
+					slot.R[inj.Jnt->getFirstDOF() + inj.Conductor] += inj.Currents[p];
+				}
+			}
+			guard.lock();
+			ready.push_back(k);
+			readyCv.notify_one();
+		}
+		{
+			lock_guard<mutex> guard(lock);
+			done = true;
+		}
+		readyCv.notify_all();
+		for (auto& th : pool) {
+			th.join();
+		}
+		Net->setFrequency(base);
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+#include "network.hpp"
+
+// Frequency sweep for harmonic and resonance studies
+
+namespace utilsim
+{
+	// Points solved with the source emfs
+	enum class Emf { FUNDAMENTAL, ALL, NONE };
+
+	class Sweep {
+		/*	Network solution at a list of frequencies
+			Numbering, nodal pattern and column ordering are shared by all points.
+			Models are evaluated and stamped on the calling thread while the workers
+			factorize earlier points, each point is handed over as a copy of the nodal values.
+			Element models carry no harmonic emissions: source emfs are fundamental phasors
+			and drive only the points at the rated frequency unless chosen otherwise,
+			harmonic currents of nonlinear equipment are given as injections.
+			The network frequency is restored after the run.
+		*/
+	public:
+		Sweep(Network* net);
+		void addFrequency(double hz);
+		// Evenly spaced points, both ends included
+		void addFrequencies(double first, double last, int count);
+		// Current into live conductor k of the junction, one phasor per frequency point (missing ones are zero)
+		void addInjection(Junction* jnt, int conductor, const vector<CPX>& currents);
+		// Points driven by the source emfs, the rest are solved for the injections only
+		void setSources(Emf points);
+		// Zero threads - hardware concurrency
+		void run(int threads = 0);
+		vector<double>& getFrequencies();
+		// Conductor voltages by DOF, one vector per frequency point (empty at singular points)
+		vector<CV>& getResults();
+	private:
+		// Nodal values of one point, on the pattern of the network matrix
+		struct Slot {
+			CSM Y = CSM(0, 0);
+			CV R = CV::zeros(0);
+			size_t Point = 0;
+		};
+		struct Injection {
+			Junction* Jnt;
+			int Conductor;
+			vector<CPX> Currents;
+		};
+		Network* Net;
+		vector<double> Frequencies;
+		vector<Injection> Injections;
+		Emf Sources = Emf::FUNDAMENTAL;
+		vector<CV> Results;
+	};
+}
+
+#endif
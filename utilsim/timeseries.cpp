@@ -0,0 +1,88 @@
+#include "timeseries.hpp"
+
+namespace utilsim
+{
+	// SINKS =============================================================
+
+	StreamSink::StreamSink(ostream& out) : Out(out) {
+
+	}
+
+	void StreamSink::write(int step, CV& voltages) {
+		Out << step;
+		for (int k = 0; k < voltages.numel(); k++) {
+			Out << "," << abs(voltages[k]);
+		}
+		Out << "\n";
+	}
+
+	// TIME SERIES =======================================================
+
+	TimeSeries::TimeSeries(Network* net) {
+		Net = net;
+		Steps = 0;
+	}
+
+	void TimeSeries::limit(int steps) {
+		// Shortest profile limits the run
+		if ((Channels.empty() && Columns.empty()) || steps < Steps) {
+			Steps = steps;
+		}
+	}
+
+	bool TimeSeries::addChannel(Element* target, const char* setting, vector<float> values) {
+		// Name is resolved once, steps use the handle
+		SettingKey key = target->getKey(setting);
+		if (key.Index < 0 || *key.Type != typeid(float) || key.Bytes != sizeof(float)) {
+			return false;
+		}
+		limit((int)values.size());
+		Channels.push_back({ target, key, values });
+		return true;
+	}
+
+	bool TimeSeries::addColumn(type_index kind, const char* setting, vector<float> values) {
+		int width = Net->countElements(kind);
+		SettingKey key = Net->getKey(kind, setting);
+		// Column writes read Bytes per element from the profile, scalar float settings only
+		if (width == 0 || key.Index < 0 || *key.Type != typeid(float) || key.Bytes != sizeof(float)) {
+			return false;
+		}
+		limit((int)values.size() / width);
+		Columns.push_back({ kind, key, width, values });
+		return true;
+	}
+
+	int TimeSeries::numel() {
+		return Steps;
+	}
+
+	bool TimeSeries::run(Sink* sink) {
+		return run(sink, 0, Steps);
+	}
+
+	bool TimeSeries::run(Sink* sink, int first, int count) {
+		int last = min(first + count, Steps);
+		for (int step = first; step < last; step++) {
+			// Parametric updates only - unchanged values do not raise flags
+			for (auto& ch : Channels) {
+				ch.Target->setValue<float>(ch.Setting, &ch.Values[step]);
+			}
+			// Bulk column writes, only elements with new values are flagged
+			for (auto& col : Columns) {
+				// Elements added or removed since addColumn would shift the profile
+				if (Net->countElements(col.Kind) != col.Width) {
+					return false;
+				}
+				Net->setValues(col.Kind, col.Setting, &col.Values[(size_t)step * col.Width]);
+			}
+			// Pattern and symbolic analysis are reused, only modified elements are refreshed
+			if (!Net->compute()) {
+				return false;
+			}
+			// Streaming
+			sink->write(step, Net->getVoltages());
+		}
+		return true;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef TIMESERIES_HPP
+#define TIMESERIES_HPP
+#include "network.hpp"
+
+// Quasi-static time-series simulation
+
+namespace utilsim
+{
+	// Result consumer, receives every solved step in order
+	class Sink {
+	public:
+		virtual ~Sink() {}
+		virtual void write(int step, CV& voltages) = 0;
+	};
+
+	// Writes conductor voltage magnitudes, one line per step
+	class StreamSink : public Sink {
+	public:
+		StreamSink(ostream& out);
+		void write(int step, CV& voltages);
+	private:
+		ostream& Out;
+	};
+
+	// Single profile: one setting of one element, one value per step
+	struct Channel {
+		Element* Target;
+		SettingKey Setting;
+		vector<float> Values;
+	};
+
+	// Column profile: one setting of every element of a kind, step-major
+	struct Column {
+		type_index Kind;
+		SettingKey Setting;
+		int Width;
+		vector<float> Values;
+	};
+
+	class TimeSeries {
+	public:
+		TimeSeries(Network* net);
+		// Profiles drive scalar float settings, false for unknown, wider or non-float settings
+		bool addChannel(Element* target, const char* setting, vector<float> values);
+		// Values for all elements of kind T (insertion order) at step 0, then step 1...
+		template<class T> bool addColumn(const char* setting, vector<float> values) {
+			return addColumn(typeid(T), setting, values);
+		}
+		bool addColumn(type_index kind, const char* setting, vector<float> values);
+		int numel();
+		// Steps [first, first + count) or the whole profile, false at the first singular step
+		// or when the element count of a column kind no longer matches its width
+		bool run(Sink* sink);
+		bool run(Sink* sink, int first, int count);
+	private:
+		Network* Net;
+		vector<Channel> Channels;
+		vector<Column> Columns;
+		int Steps;
+		void limit(int steps);
+	};
+}
+
+#endif
@@ -1,9 +1,18 @@
 #include "topology.hpp"
 #include "network.hpp"
 #include "settings.hpp"
+#include <stdexcept>
 
 namespace utilsim
 {
+	// Settings instance of a new object, the storage is bounded and an object beyond it cannot exist
+	static int allocated(int inst) {
+		if (inst < 0) {
+			throw length_error("Settings instance capacity exhausted");
+		}
+		return inst;
+	}
+
 	// JUNCTION ==========================================================
 
 	Junction::Junction(NID* pid) {
@@ -18,117 +27,140 @@ namespace utilsim
 	// Modification interface
 
 	void Junction::connectPort(Port* prt) {
+		connectPorts(&prt, 1);
+	}
+
+	void Junction::connectPorts(Port* const* ports, int count) {
 		// Adding to reference storage
-		ConnectedPorts.push_back(prt);
+		ConnectedPorts.insert(ConnectedPorts.end(), ports, ports + count);
+		raise();
 		// Delayed processing avoided - expected immediate structure modification
-		// Implementing default mapping on connection
-		for (int k = Conductors.size(); k < prt->Terminals.size(); k++) {
+		// Implementing default mapping on connection, conductors for the widest port at once
+		size_t width = 0;
+		for (int k = 0; k < count; k++) {
+			width = max(width, ports[k]->Terminals.size());
+		}
+		int live = (int)(Conductors.size() - Released.size());
+		Conductors.reserve(Conductors.size() + max((int)width - live, 0));
+		for (int k = live; k < (int)width; k++) {
 			createConductor();
-			cout << k << endl;
 		}
-		cout << this << "\n";
-		// Registering in default order
-		for (int k = 0; k < Conductors.size(); k++) {
-			Conductors[k].Plugs.push_back(&prt->Terminals[k]);
-			cout << "inter\n";
-			prt->Terminals[k].Socket = &Conductors[k];
+		// Registering in default order over live conductors
+		for (int k = 0; k < count; k++) {
+			int cidx = 0;
+			for (auto& term : ports[k]->Terminals) {
+				while (Conductors[cidx].Parent == nullptr) {
+					cidx++;
+				}
+				Conductors[cidx].Plugs.push_back(&term);
+				term.Socket = cidx++;
+			}
 		}
 	}
 	
-	Conductor* Junction::createConductor() {
+	void Junction::disconnectPort(Port* port) {
+		if (port->Connection != this) {
+			return;
+		}
+		// Conductors are looked up through the port, so it is unwired last
+		for (auto& term : port->Terminals) {
+			disconnectTerminal(&term);
+		}
+		ConnectedPorts.erase(remove(ConnectedPorts.begin(), ConnectedPorts.end(), port), ConnectedPorts.end());
+		port->Connection = nullptr;
+		raise();
+	}
+
+	int Junction::createConductor() {
+		raise();
+		// Reusing removed slot
+		if (!Released.empty()) {
+			int idx = Released.back();
+			Released.pop_back();
+			Conductors[idx].Parent = this;
+			return idx;
+		}
 		Conductors.push_back(Conductor());
-		State = ModifiedState::TOPOLOGY;
-		return &Conductors[Conductors.size() - 1];
+		Conductors.back().Parent = this;
+		Conductors.back().DOF = -1;
+		return (int)Conductors.size() - 1;
 	}
 
 	Conductor* Junction::getConductor(Terminal* targetTerm) {
-		// Searh
-		for (auto& cond : Conductors) {
-			for (auto& term : cond.Plugs) {
-				if (term == targetTerm) {
-					return &cond;
-				}
-			}
+		if (targetTerm->Socket < 0 || targetTerm->Parent->Connection != this) {
+			return nullptr;
 		}
-		// Default
-		return nullptr;
+		return &Conductors[targetTerm->Socket];
 	}
 
 	void Junction::connectTerminal(Terminal* term) {
 		// Checking if terminal belongs to one of connected ports
-		for (auto prt : ConnectedPorts) {
-			if (term->Parent == prt) {
-				// It does
-				// Trying to find conductor not used by current port
-				Conductor* cptr = nullptr;
-				for (auto& cond : Conductors) {
-					// Start value
-					bool used = false;
-					// Check
-					for (auto& con : cond.Plugs) {
-						if (con->Parent == prt) {
-							// The Terminal already connected!
-							if (con == term) {
-								return;
-							}
-							// Conductor used
-							used = true;
-							break;
-						}
-					}
-					// Free conductor found
-					if (~used) {
-						cptr = &cond;
-						break;
-					}
-				}
-				// If all conductors occupied
-				if (cptr == nullptr) {
-					cptr = createConductor();
+		Port* prt = term->Parent;
+		if (prt->Connection != this || term->Socket >= 0) {
+			return;
+		}
+		// Trying to find live conductor not used by current port
+		int cidx = -1;
+		for (int k = 0; k < (int)Conductors.size() && cidx < 0; k++) {
+			if (Conductors[k].Parent == nullptr) {
+				continue;
+			}
+			cidx = k;
+			for (auto& other : prt->Terminals) {
+				if (other.Socket == k) {
+					// Conductor used
+					cidx = -1;
+					break;
 				}
-				// Finalization
-				cptr->Plugs.push_back(term);
-				term->Socket = cptr;
 			}
 		}
+		// If all conductors occupied
+		if (cidx < 0) {
+			cidx = createConductor();
+		}
+		// Finalization
+		Conductors[cidx].Plugs.push_back(term);
+		term->Socket = cidx;
 	}
 
 	void Junction::disconnectTerminal(Terminal* term) {
-		// Overengineered?
-		// 
 		// Disconnects single terminal and controlls resulting junction consistency
-		for (auto it_cond = Conductors.begin(); it_cond < Conductors.end(); it_cond++) {			
-			for (auto it_term = it_cond->Plugs.begin(); it_term < it_cond->Plugs.end(); it_term++) {
-				if (*it_term == term) {
-					// Removing
-					it_cond->Plugs.erase(it_term);
-					term->Socket = nullptr;
-					// Controlling empty conductors
-					if (it_cond->Plugs.empty()) {
-						Conductors.erase(it_cond);
-						State = ModifiedState::TOPOLOGY;
-					}
-					// Termination
-					return;
-				}
+		Conductor* cond = getConductor(term);
+		if (cond == nullptr) {
+			return;
+		}
+		for (auto it_term = cond->Plugs.begin(); it_term < cond->Plugs.end(); it_term++) {
+			if (*it_term == term) {
+				cond->Plugs.erase(it_term);
+				break;
 			}
-			
 		}
-		
+		// Controlling empty conductors - slot is kept so other handles stay valid
+		if (cond->Plugs.empty()) {
+			cond->Parent = nullptr;
+			Released.push_back(term->Socket);
+			raise();
+		}
+		term->Socket = -1;
 	}
 
-	void Junction::reconnectTerminal(Terminal* term, Conductor* target) {
+	void Junction::reconnectTerminal(Terminal* term, int target) {
+		if (target < 0 || target >= (int)Conductors.size() || Conductors[target].Parent == nullptr) {
+			return;
+		}
 		// Disconnecting
 		disconnectTerminal(term);
-		
 		// Reconnecting
-		for (auto& cond : Conductors) {
-			// Extending
-			if (&cond == target) {
-				cond.Plugs.push_back(term);
-				term->Socket = target;
-			}			
+		Conductors[target].Plugs.push_back(term);
+		term->Socket = target;
+		raise();
+	}
+
+	void Junction::raise() {
+		if (State == ModifiedState::NONE) {
+			Parent->notify(this);
 		}
+		State = ModifiedState::TOPOLOGY;
 	}
 
 	// Calculation engine interface
@@ -136,19 +168,32 @@ namespace utilsim
 		return State;
 	}
 
-	void Junction::index(int& idx) {
-		// Filling voltage DOFs
+	void Junction::index(int& next, bool reset) {
+		// Live conductors are consecutive, the DOF block is kept while they fit
+		int live = countConductors();
+		if (reset || live > Capacity) {
+			FirstDOF = next;
+			Capacity = live;
+			next += live;
+		}
+		int idx = FirstDOF;
 		for (auto& cond : Conductors) {
-			cond.DOF = idx++;
+			cond.DOF = cond.Parent == nullptr ? -1 : idx++;
 		}
+		// Status
+		State = ModifiedState::NONE;
 	}
 
-	void Junction::fill(CSM& T) {
-		for (auto& cond : Conductors) {
-			for (auto& term : cond.Plugs) {
-				T(cond.DOF, term->DOF) = CPX(1, 0);
-			}
-		}
+	int Junction::getFirstDOF() {
+		return FirstDOF;
+	}
+
+	int Junction::getCapacity() {
+		return Capacity;
+	}
+
+	int Junction::countConductors() {
+		return (int)(Conductors.size() - Released.size());
 	}
 
 	// Debug
@@ -173,12 +218,12 @@ namespace utilsim
 	void Port::setTerminals(vector<const char*> conds) {
 
 		// Renaming intersection
-		for (int k = 0; k < Terminals.size() && k < conds.size(); k++) {
+		for (int k = 0; k < (int)Terminals.size() && k < (int)conds.size(); k++) {
 			Terminals[k].ID = conds[k];
 		}
 
 		// Adding missing terminals
-		for (int k = Terminals.size(); k < conds.size(); k++) {
+		for (int k = (int)Terminals.size(); k < (int)conds.size(); k++) {
 			// Common
 			Terminals.push_back(Terminal());
 			Terminals.back().ID = conds[k];
@@ -191,7 +236,9 @@ namespace utilsim
 
 		// Removing excessive terminals
 		for (int k = Terminals.size()-1;  k >= (int)conds.size(); k--) {
-			Connection->disconnectTerminal(&Terminals[k]);
+			if (Connection != nullptr) {
+				Connection->disconnectTerminal(&Terminals[k]);
+			}
 			Terminals.pop_back();
 		}
 	}
@@ -200,19 +247,77 @@ namespace utilsim
 	
 	// ELEMENT ===========================================================
 
-	Element::Element(NID *parent, vector<const char*> pnames, SettingsData *sd) : SET(sd->getInstance()) {
+	Element::Element(NID *parent, vector<const char*> pnames, SettingsData *sd) : SET(allocated(sd->getInstance())) {
 		Parent = parent;
 		SDR = sd;
 		// Creating default ports (fixed for given element type)
 		Ports = vector<Port>();
 		Ports.reserve(pnames.size());
-		for (int k = 0; k < pnames.size(); k++) {
+		for (int k = 0; k < (int)pnames.size(); k++) {
 			Ports.push_back(Port(this, pnames[k], {}));
 		}
 	}
 
+	Element::Element(const Element& other) : SDR(other.SDR), SET(allocated(other.SDR->cloneInstance(other.SET))), Parent(other.Parent),
+		S(other.S), J(other.J), Lib(other.Lib), State(ModifiedState::NONE), FirstDOF(other.FirstDOF), Capacity(other.Capacity),
+		Nodes(other.Nodes), Slots(other.Slots) {
+		// Assembly indices of the original, stamps go to the same slots
+	}
+
 	Element::~Element() {
-		delete SET;
+		if (Lib != nullptr) {
+			Lib->detach(this);
+		}
+		SDR->releaseInstance(SET);
+	}
+
+	SettingKey Element::getKey(const char* name) {
+		return SDR->getKey(name);
+	}
+
+	SettingsData* Element::getSettings() {
+		return SDR;
+	}
+
+	int Element::getInstance() {
+		return SET;
+	}
+
+	void Element::link(Record* rec) {
+		if (Lib == rec) {
+			return;
+		}
+		if (Lib != nullptr) {
+			Lib->detach(this);
+		}
+		Lib = rec;
+		if (Lib != nullptr) {
+			Lib->attach(this);
+		}
+		raise(ModifiedState::PARAMETRIC);
+	}
+
+	Record* Element::getRecord() {
+		return Lib;
+	}
+
+	void Element::raise(ModifiedState state) {
+		ModifiedState prior = State;
+		if (State == ModifiedState::NONE) {
+			// First change since the last calculation
+			Parent->notify(this);
+		}
+		if (state == ModifiedState::TOPOLOGY) {
+			State = ModifiedState::TOPOLOGY;
+			// Port rewiring waits for the commit inside transactions
+			if (!Parent->defer(this, prior)) {
+				updateTopology();
+			}
+		}
+		else if (State == ModifiedState::NONE) {
+			// Pending topology change is never downgraded
+			State = state;
+		}
 	}
 
 	CDM& Element::getS() {
@@ -223,27 +328,91 @@ namespace utilsim
 		return J;
 	}
 
+	vector<int>& Element::getNodes() {
+		return Nodes;
+	}
+
+	bool Element::isConnected() {
+		for (auto& prt : Ports) {
+			if (prt.Connection == nullptr) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int Element::getFirstDOF() {
+		return FirstDOF;
+	}
+
+	int Element::getCapacity() {
+		return Capacity;
+	}
+
+	int Element::countPorts() {
+		return (int)Ports.size();
+	}
+
+	Port* Element::getPort(int port) {
+		return &Ports[port];
+	}
+
+	int Element::findPort(const char* portName) {
+		// Port names are literals - identity first, contents as fallback
+		for (int k = 0; k < (int)Ports.size(); k++) {
+			if (Ports[k].ID == portName) {
+				return k;
+			}
+		}
+		for (int k = 0; k < (int)Ports.size(); k++) {
+			if (strcmp(Ports[k].ID, portName) == 0) {
+				return k;
+			}
+		}
+		return -1;
+	}
+
 	void Element::connect(const char* portName, Junction* jnt) {
+		connect(findPort(portName), jnt);
+	}
+
+	void Element::connect(int port, Junction* jnt) {
 		// Validation
-		if (!jnt->isFromNetwork(Parent)) {
-			// Attempt to connect between different networks
+		if (port < 0 || port >= (int)Ports.size() || !jnt->isFromNetwork(Parent)) {
+			// Unknown port or attempt to connect between different networks
 			return;
 		}
-		// Identifying port pointer
-		for (auto& prt : Ports) {
-			if (prt.ID == portName) {
-				prt.Connection = jnt;
-				jnt->connectPort(&prt);
-				break;
-			}
+		if (Parent->defer(this, port, jnt)) {
+			return;
+		}
+		Port& prt = Ports[port];
+		if (prt.Connection == jnt) {
+			return;
+		}
+		// Moved port is taken off its previous junction first
+		if (prt.Connection != nullptr) {
+			prt.Connection->disconnectPort(&prt);
 		}
+		prt.Connection = jnt;
+		jnt->connectPort(&prt);
 	}
 
 	ModifiedState Element::getState() {
 		return State;
 	}
 
-	void Element::index(int& idx) {
+	void Element::index(int& next, bool reset) {
+		// Terminal DOFs are consecutive per element, the block is kept while they fit
+		int count = 0;
+		for (auto& prt : Ports) {
+			count += (int)prt.Terminals.size();
+		}
+		if (reset || count > Capacity) {
+			FirstDOF = next;
+			Capacity = count;
+			next += count;
+		}
+		int idx = FirstDOF;
 		for (auto &prt : Ports) {
 			for (auto term = prt.Terminals.begin(); term != prt.Terminals.end(); term++) {
 				term->DOF = idx++;
@@ -251,52 +420,105 @@ namespace utilsim
 		}
 	}
 
-	void Element::fill(CSM& sigma, CV& source) {
-		// Matrices update
-		if (State != ModifiedState::NONE) {
-			updateModel();
+	void Element::nodes() {
+		// Conductor DOFs of all terminals in port order
+		Nodes.clear();
+		if (!isConnected()) {
+			return;
 		}
-
-		// Output writing
-		// 
-		// Consider persistent storage for indices
-		vector<int> i_index;
-		vector<int> v_index;
-		i_index.reserve(S.cols());
-		v_index.reserve(S.cols());
-		for (auto prt : Ports) {
+		for (auto& prt : Ports) {
 			for (auto term = prt.Terminals.begin(); term != prt.Terminals.end(); ++term) {
-				i_index.push_back(term->DOF);
-				v_index.push_back(term->Socket->DOF);
+				Nodes.push_back(prt.Connection->getConductor(&*term)->DOF);
 			}
 		}
+	}
 
-		// Sigma matrix update
-		sigma.setElements(i_index, v_index, S);
-		// Source term update
-		for (int i = 0; i < J.numel(); i++) {
-			source[i_index[i]] = J[i];
+	void Element::pattern(CSM& Y) {
+		nodes();
+		Y.addPattern(Nodes, Nodes);
+	}
+
+	void Element::locate(CSM& Y) {
+		Y.getSlots(Nodes, Nodes, Slots);
+	}
+
+	void Element::map(vector<int>& incidence) {
+		// Terminal DOF to conductor DOF, terminals of an open element map nowhere
+		if (!isConnected()) {
+			return;
 		}
+		for (auto& prt : Ports) {
+			for (auto term = prt.Terminals.begin(); term != prt.Terminals.end(); ++term) {
+				incidence[term->DOF] = prt.Connection->getConductor(&*term)->DOF;
+			}
+		}
+	}
+
+	void Element::fill(CSM& Y, CV& R) {
+		// Model is expected to be updated by the owning pool
+		stamp(Y, R);
 		// Status
 		State = ModifiedState::NONE;
 	}
 
-	void Element::configurePort(const char* pid, vector<const char*> terms) {
-		for (auto& prt : Ports) {
-			if (prt.ID == pid) {
-				// The one
+	void Element::stamp(CSM& Y, CV& R) const {
+		if (Nodes.empty()) {
+			return;
+		}
+		// Nodal stamp: terminal currents are summed directly into their conductors
+		Y.addValues(Slots, S);
+		// Source term update, sum of I = S * V + J vanishes at every conductor
+		for (int i = 0; i < J.numel(); i++) {
+			R[Nodes[i]] -= J[i];
+		}
+	}
 
-				// Checking if topology reset required
-				if (prt.Terminals.size() != terms.size()) {
-					State = ModifiedState::TOPOLOGY;
-				}
+	void Element::unfill(CSM& Y, CV& R) const {
+		// Withdrawal of the stamp placed by the last fill
+		if (Nodes.empty()) {
+			return;
+		}
+		Y.subValues(Slots, S);
+		for (int i = 0; i < J.numel(); i++) {
+			R[Nodes[i]] += J[i];
+		}
+	}
 
-				// Updating port
-				prt.setTerminals(terms);
+	void Element::log(const SettingKey& key) {
+		Parent->log(SDR, SET, key);
+	}
 
-				return;
+	double Element::frequency() {
+		return Parent->getFrequency();
+	}
+
+	double Element::harmonic() {
+		return Parent->getFrequency() / Parent->getRatedFrequency();
+	}
+
+	double Element::ratedFrequency() {
+		return Parent->getRatedFrequency();
+	}
+
+	int Element::branches(vector<Branch>&) {
+		return 0;
+	}
+
+	void Element::configurePort(const char* pid, vector<const char*> terms) {
+		int k = findPort(pid);
+		if (k < 0) {
+			return;
+		}
+		Port& prt = Ports[k];
+		// Checking if topology reset required
+		if (prt.Terminals.size() != terms.size()) {
+			if (State == ModifiedState::NONE) {
+				Parent->notify(this);
 			}
+			State = ModifiedState::TOPOLOGY;
 		}
+		// Updating port
+		prt.setTerminals(terms);
 	}
 
 
@@ -324,8 +546,93 @@ namespace utilsim
 	}	
 
 	// RECORD ============================================================
-	Record::Record(void* data, SettingsData* sdr) : Data(data), Meta(sdr) {
+	Record::Record(int data, SettingsData* sdr) : Data(allocated(data)), Meta(sdr) {
+
+	}
+
+	Record::~Record() {
+		// Dependents fall back to their own defaults
+		vector<Element*> deps;
+		deps.swap(Dependents);
+		for (auto elem : deps) {
+			elem->link(nullptr);
+		}
+		Meta->releaseInstance(Data);
+	}
+
+	SettingKey Record::getKey(const char* name) {
+		return Meta->getKey(name);
+	}
+
+	SettingsData* Record::getSettings() {
+		return Meta;
+	}
+
+	int Record::getInstance() {
+		return Data;
+	}
+
+	void Record::attach(Element* elem) {
+		Dependents.push_back(elem);
+	}
+
+	void Record::detach(Element* elem) {
+		for (auto it = Dependents.begin(); it != Dependents.end(); it++) {
+			if (*it == elem) {
+				Dependents.erase(it);
+				return;
+			}
+		}
+	}
+
+	shared_ptr<vector<CDM>> Record::findModel(const ModelKey& key) {
+		lock_guard<mutex> guard(ModelLock);
+		auto it = Models.find(key);
+		if (it == Models.end()) {
+			return nullptr;
+		}
+		// Hit moves the set to the back of the eviction order
+		ModelOrder.splice(ModelOrder.end(), ModelOrder, it->second.Use);
+		return it->second.Model;
+	}
+
+	shared_ptr<vector<CDM>> Record::storeModel(const ModelKey& key, vector<CDM> model) {
+		lock_guard<mutex> guard(ModelLock);
+		auto it = Models.find(key);
+		if (it != Models.end()) {
+			// Concurrently evaluated by another thread
+			return it->second.Model;
+		}
+		evict(ModelLimit - 1);
+		ModelOrder.push_back(key);
+		CachedModel& entry = Models[key];
+		entry.Model = make_shared<vector<CDM>>(std::move(model));
+		entry.Use = prev(ModelOrder.end());
+		return entry.Model;
+	}
+
+	void Record::setModelLimit(size_t limit) {
+		lock_guard<mutex> guard(ModelLock);
+		ModelLimit = max(limit, (size_t)1);
+		evict(ModelLimit);
+	}
+
+	size_t Record::getModelLimit() {
+		lock_guard<mutex> guard(ModelLock);
+		return ModelLimit;
+	}
+
+	void Record::evict(size_t limit) {
+		while (ModelOrder.size() > limit) {
+			Models.erase(ModelOrder.front());
+			ModelOrder.pop_front();
+		}
+	}
 
+	void Record::invalidate() {
+		lock_guard<mutex> guard(ModelLock);
+		Models.clear();
+		ModelOrder.clear();
 	}
 
 
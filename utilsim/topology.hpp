@@ -2,7 +2,12 @@
 #define TOPOLOGY_HPP
 
 #include <vector>
+#include <deque>
+#include <list>
 #include <map>
+#include <array>
+#include <memory>
+#include <mutex>
 #include <iostream>
 #include "linalg.hpp"
 #include "settings.hpp"
@@ -25,6 +30,9 @@ namespace utilsim
 	class Element;
 	class Network;
 	class NID;
+	class Record;
+	class Snapshot;
+	class Scenario;
 
 	// Junction
 	
@@ -41,22 +49,38 @@ namespace utilsim
 		bool isFromNetwork(NID* nptr);
 		// Model assembly		
 		void connectPort(Port* port);
+		void connectPorts(Port* const* ports, int count);
+		// Terminals leave their conductors, the port is unwired
+		void disconnectPort(Port* port);
 		void connectTerminal(Terminal* term);
-		Conductor* createConductor();
+		int createConductor();
 		Conductor* getConductor(Terminal* term);
-		void reconnectTerminal(Terminal* term, Conductor* target);
+		void reconnectTerminal(Terminal* term, int target);
 		void disconnectTerminal(Terminal* term);
 		// Matrix assembly
 		ModifiedState getState();
-		void index(int& pos);
-		void fill(CSM& T);	
+		// Numbering from next, reset - always a new block
+		void index(int& next, bool reset = true);
+		// Voltage DOFs of live conductors, valid after calculation
+		int getFirstDOF();
+		int getCapacity();
+		int countConductors();
 		//Debug
 		void print();		
 	private:
+		friend class Network;
+		friend class Snapshot;
 		Junction() = delete;
+		// Topology invalidation, the first change is reported to the network
+		void raise();
 		NID* Parent;
 		vector<Port*> ConnectedPorts;
+		// Reserved DOF block
+		int FirstDOF = 0;
+		int Capacity = 0;
+		// Conductors are addressed by index, removed ones are tombstoned (null Parent) and reused
 		vector<Conductor> Conductors;
+		vector<int> Released;
 		ModifiedState State = ModifiedState::TOPOLOGY;
 	};
 
@@ -66,7 +90,8 @@ namespace utilsim
 		// Element's port single conductor
 		Port* Parent;
 		int DOF;
-		Conductor* Socket;
+		// Conductor index in the connected junction, -1 when unplugged
+		int Socket = -1;
 		const char* ID;
 	};
 
@@ -75,11 +100,26 @@ namespace utilsim
 		const char* ID;
 		Element* Parent;
 		Junction* Connection;
-		vector<Terminal> Terminals;
+		// Chunked storage - conductors keep plain pointers to terminals
+		deque<Terminal> Terminals;
 		Port(Element* parent, const char* id, vector<const char*> condNames);
 		void setTerminals(vector<const char*> condNames);
 	};
 
+	// Lumped branch of a time-domain element model, series R-L with emf or shunt C
+	struct Branch {
+		// Terminal index in port order, Ground, or internal node k as -2 - k
+		static const int Ground = -1;
+		int From;
+		int To;
+		double R;
+		double L;
+		// Capacitance, R and L are ignored when set
+		double C;
+		// Emf driving current From -> To, peak phasor at network frequency
+		CPX E;
+	};
+
 	class Element {
 		/*	Generic network element
 			I = S*V + J
@@ -90,63 +130,169 @@ namespace utilsim
 			J - source term
 		*/
 	public:
+		// Both constructors throw length_error when no settings instance is left
 		Element(NID* pid, vector<const char*> pnames, SettingsData* sd);
-		~Element();
+		// Detached copy with own settings instance, ports are not wired and the library record is not notified
+		Element(const Element& other);
+		virtual Element* clone() = 0;
+		virtual ~Element();
 		// Model assembly
+		int findPort(const char* portName);
 		void connect(const char* portName, Junction* jnt);
+		void connect(int port, Junction* jnt);
 		// Model settings
+		SettingKey getKey(const char* name);
 		template<class T> void setValue(const char* name, void* value) {
+			setValue<T>(SDR->getKey(name), value);
+		}
+		template<class T> void setValue(const SettingKey& key, void* value) {
+			// Previous value is kept inside transactions
+			log(key);
 			// Performing operation
-			unsigned char status = SDR->setValue(SET, name, value);
+			unsigned char status = SDR->setValue<T>(SET, key, value);
 			// Rizing flags
 			if (status & (1 << (int)SettingStatus::Modified)) {
 				if (status & (1 << (int)SettingStatus::Topology)) {
 					// Topological modification
-					State = ModifiedState::TOPOLOGY;
-					updateTopology();
+					raise(ModifiedState::TOPOLOGY);
 				}
 				else {
 					// Minor change
-					State = ModifiedState::PARAMETRIC;
+					raise(ModifiedState::PARAMETRIC);
 				}
 			}
 		}
 		template<class T> void getValue(const char* name, void* value) {
-			SDR->getValue(SET, name, value);
-		}		
+			SDR->getValue<T>(SET, name, value);
+		}
+		template<class T> void getValue(const SettingKey& key, void* value) {
+			SDR->getValue<T>(SET, key, value);
+		}
+		SettingsData* getSettings();
+		int getInstance();
+		// Library type, shared by elements of the same kind
+		void link(Record* rec);
+		Record* getRecord();
+		// Invalidation, topology change reconfigures ports immediately
+		void raise(ModifiedState state);
 		// Matrix assembly
 		ModifiedState getState();
-		void index(int& pos);
-		void fill(CSM& sigma, CV& source);		
+		// Numbering from next, reset - always a new block
+		void index(int& next, bool reset = true);
+		void nodes();
+		void pattern(CSM& Y);
+		void locate(CSM& Y);
+		void map(vector<int>& incidence);
+		void fill(CSM& Y, CV& R);
+		void unfill(CSM& Y, CV& R) const;
+		// Stamp of the current model only, the element state is left unchanged
+		void stamp(CSM& Y, CV& R) const;
+		// Time-domain model, returns number of internal nodes; elements without one are skipped
+		virtual int branches(vector<Branch>& out);
+		// Current stamp, valid after calculation
+		CDM& getS();
+		CV& getJ();
+		// Nodes are empty while a port is open, such an element is left out of the calculation
+		vector<int>& getNodes();
+		bool isConnected();
+		// Terminal DOFs, consecutive from the first one
+		int getFirstDOF();
+		int getCapacity();
+		// Structure access for bulk construction
+		int countPorts();
+		Port* getPort(int port);
 		// Debug
 		void print();
 	protected:
 		// Settings
 		SettingsData* SDR;
-		void* SET;
+		int SET;
 		// Topology		
 		NID* Parent;		
+		void log(const SettingKey& key);
+		// Analysis frequency in Hz and its ratio to the rated one
+		double frequency();
+		double harmonic();
+		double ratedFrequency();
 		void configurePort(const char* pid, vector<const char*> terms);
 		virtual void updateModel() = 0;
 		virtual void updateTopology() = 0;
 		// Element representation
 		CDM S;
 		CV J;
-		CDM& getS();
-		CV& getJ();
+		Record* Lib = nullptr;
 	private:
+		friend class Network;
+		friend class Scenario;
 		vector<Port> Ports;
 		ModifiedState State = ModifiedState::TOPOLOGY;
+		// Assembly indices, valid until next topology change
+		int FirstDOF = 0;
+		int Capacity = 0;
+		vector<int> Nodes;
+		vector<int> Slots;
 	};
 
 
+	// Model parameter set identifying shared model data
+	typedef array<double, 4> ModelKey;
+
 	//  Library record
 	class Record {
 	public:
-		Record(void* data, SettingsData* sdr);
+		// Throws length_error for a failed instance allocation (negative data)
+		Record(int data, SettingsData* sdr);
+		~Record();
+		// Owns its settings instance and dependents list
+		Record(const Record&) = delete;
+		Record& operator=(const Record&) = delete;
+		// Model settings, modification invalidates all dependents
+		SettingKey getKey(const char* name);
+		template<class T> void setValue(const char* name, void* value) {
+			setValue<T>(Meta->getKey(name), value);
+		}
+		template<class T> void setValue(const SettingKey& key, void* value) {
+			unsigned char status = Meta->setValue<T>(Data, key, value);
+			if (status & (1 << (int)SettingStatus::Modified)) {
+				invalidate();
+				for (auto elem : Dependents) {
+					elem->raise((status & (1 << (int)SettingStatus::Topology)) ? ModifiedState::TOPOLOGY : ModifiedState::PARAMETRIC);
+				}
+			}
+		}
+		template<class T> void getValue(const char* name, void* value) {
+			Meta->getValue<T>(Data, name, value);
+		}
+		template<class T> void getValue(const SettingKey& key, void* value) {
+			Meta->getValue<T>(Data, key, value);
+		}
+		SettingsData* getSettings();
+		int getInstance();
+		// Dependents
+		void attach(Element* elem);
+		void detach(Element* elem);
+		// Shared model matrices, computed once per parameter set
+		// Thread safe and read only, entries stay valid while referenced after eviction
+		shared_ptr<vector<CDM>> findModel(const ModelKey& key);
+		shared_ptr<vector<CDM>> storeModel(const ModelKey& key, vector<CDM> model);
+		// Parameter sets kept per record (at least one), e.g. the point count of a repeated sweep
+		void setModelLimit(size_t limit);
+		size_t getModelLimit();
 	private:
-		void* Data;
+		int Data;
 		SettingsData* Meta;
+		vector<Element*> Dependents;
+		// Bounded model cache, least recently used parameter set is evicted first
+		struct CachedModel {
+			shared_ptr<vector<CDM>> Model;
+			list<ModelKey>::iterator Use;
+		};
+		size_t ModelLimit = 8;
+		mutex ModelLock;
+		map<ModelKey, CachedModel> Models;
+		list<ModelKey> ModelOrder;
+		void evict(size_t limit);
+		void invalidate();
 	};
 }
 
@@ -0,0 +1,220 @@
+#include "transient.hpp"
+
+namespace utilsim
+{
+	Transient::Transient(Network* net) : Y(CSM(0, 0)), R(CV::zeros(0)), V(CV::zeros(0)) {
+		Net = net;
+	}
+
+	bool Transient::refresh() {
+		// Network brought up to date, branches follow any change since the last build
+		Net->commit();
+		Net->assemble(false);
+		if (Built == Net->Revision) {
+			return false;
+		}
+		build();
+		return true;
+	}
+
+	void Transient::build() {
+		// Network numbering, internal nodes of the element models are appended
+		vector<Companion> prior;
+		prior.swap(Companions);
+		Nodes = Net->VDOFS;
+		Branches.clear();
+		vector<Branch> local;
+		for (auto elem : Net->Elements) {
+			if (elem->getNodes().empty()) {
+				// Open element, out of the calculation
+				continue;
+			}
+			local.clear();
+			int internal = elem->branches(local);
+			vector<int>& nodes = elem->getNodes();
+			auto node = [&](int k) {
+				return k >= 0 ? nodes[k] : k == Branch::Ground ? -1 : Nodes - 2 - k;
+			};
+			for (auto& br : local) {
+				Branches.push_back(br);
+				Companions.push_back({ node(br.From), node(br.To), 0, 0, 0, br.E, 0, 0 });
+			}
+			Nodes += internal;
+		}
+		Built = Net->Revision;
+		// Branch states carry over a parametric change, a new structure starts de-energized
+		bool same = prior.size() == Companions.size() && V.numel() == Nodes;
+		for (size_t k = 0; same && k < prior.size(); k++) {
+			same = prior[k].From == Companions[k].From && prior[k].To == Companions[k].To;
+		}
+		if (same) {
+			for (size_t k = 0; k < prior.size(); k++) {
+				Companions[k].Vb = prior[k].Vb;
+				Companions[k].I = prior[k].I;
+			}
+		}
+		else {
+			V = CV::zeros(Nodes);
+			Patterned = false;
+		}
+	}
+
+	void Transient::reset() {
+		Time = 0;
+		Count = 0;
+		for (auto& cp : Companions) {
+			cp.Vb = 0;
+			cp.I = 0;
+		}
+		V = CV::zeros(Nodes);
+	}
+
+	bool Transient::setStep(double dt) {
+		if (dt <= 0) {
+			return false;
+		}
+		refresh();
+		Step = dt;
+		Ready = factor();
+		return Ready;
+	}
+
+	bool Transient::factor() {
+		// Companion coefficients
+		double dt = Step;
+		for (size_t k = 0; k < Companions.size(); k++) {
+			Branch& br = Branches[k];
+			Companion& cp = Companions[k];
+			if (br.C > 0) {
+				cp.G = 2.0 * br.C / dt;
+				cp.A = -cp.G;
+				cp.B = -1;
+			}
+			else if (br.R + 2.0 * br.L / dt > 0) {
+				cp.G = 1.0 / (br.R + 2.0 * br.L / dt);
+				cp.A = cp.G;
+				cp.B = cp.G * (2.0 * br.L / dt - br.R);
+			}
+			else {
+				// Ideal short (e.g. zero length line) has no companion conductance
+				return false;
+			}
+		}
+		// Conductance pattern and analysis once per branch structure
+		if (!Patterned) {
+			pattern();
+		}
+		else {
+			Y.setZero();
+		}
+		for (size_t k = 0; k < Companions.size(); k++) {
+			Companion& cp = Companions[k];
+			int n = Slots[k].size() == 4 ? 2 : Slots[k].size();
+			CDM G = CDM(n, n);
+			if (n == 2) {
+				G << cp.G, -cp.G, -cp.G, cp.G;
+			}
+			else if (n == 1) {
+				G << cp.G;
+			}
+			Y.addValues(Slots[k], G);
+		}
+		Y.addValue(UnusedSlots, CPX(1, 0));
+		return Solver.factorize(Y);
+	}
+
+	void Transient::pattern() {
+		// Nodes without branches are decoupled by a unit diagonal
+		Y = CSM(Nodes, Nodes);
+		vector<char> used(Nodes, 0);
+		vector<vector<int>> dofs(Companions.size());
+		for (size_t k = 0; k < Companions.size(); k++) {
+			for (int n : { Companions[k].From, Companions[k].To }) {
+				if (n >= 0) {
+					dofs[k].push_back(n);
+					used[n] = 1;
+				}
+			}
+			Y.addPattern(dofs[k], dofs[k]);
+		}
+		Unused.clear();
+		for (int k = 0; k < Nodes; k++) {
+			if (!used[k]) {
+				Unused.push_back(k);
+				vector<int> dof = { k };
+				Y.addPattern(dof, dof);
+			}
+		}
+		Y.buildPattern();
+		Slots.resize(Companions.size());
+		for (size_t k = 0; k < Companions.size(); k++) {
+			Y.getSlots(dofs[k], dofs[k], Slots[k]);
+		}
+		UnusedSlots.clear();
+		vector<int> slot;
+		for (auto k : Unused) {
+			vector<int> dof = { k };
+			Y.getSlots(dof, dof, slot);
+			UnusedSlots.push_back(slot[0]);
+		}
+		Solver.analyze(Y);
+		R = CV::zeros(Nodes);
+		Patterned = true;
+	}
+
+	bool Transient::run(int steps, Sink* sink) {
+		if (Step <= 0) {
+			return false;
+		}
+		if (refresh()) {
+			// Network changed since the last build
+			Ready = factor();
+		}
+		if (!Ready) {
+			return false;
+		}
+		double w = 2.0 * 3.1415 * Net->getFrequency();
+		vector<double> e(Companions.size());
+		vector<double> h(Companions.size());
+		for (int s = 0; s < steps; s++) {
+			Time += Step;
+			CPX rot = exp(CPX(0, w * Time));
+			// Emf and history injections, current into the element at From
+			R.setZero();
+			for (size_t k = 0; k < Companions.size(); k++) {
+				Companion& cp = Companions[k];
+				e[k] = (cp.E * rot).real();
+				h[k] = cp.A * cp.Vb + cp.B * cp.I;
+				double inj = cp.G * e[k] + h[k];
+				if (cp.From >= 0) {
+					R[cp.From] -= inj;
+				}
+				if (cp.To >= 0) {
+					R[cp.To] += inj;
+				}
+			}
+			// Forward/back substitution only
+			V = Solver.solve(R);
+			// Branch states for the next history terms
+			for (size_t k = 0; k < Companions.size(); k++) {
+				Companion& cp = Companions[k];
+				double v = (cp.From >= 0 ? V[cp.From].real() : 0) - (cp.To >= 0 ? V[cp.To].real() : 0);
+				cp.Vb = v + e[k];
+				cp.I = cp.G * cp.Vb + h[k];
+			}
+			if (sink != nullptr) {
+				sink->write(Count, V);
+			}
+			Count++;
+		}
+		return true;
+	}
+
+	double Transient::getTime() {
+		return Time;
+	}
+
+	CV& Transient::getVoltages() {
+		return V;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef TRANSIENT_HPP
+#define TRANSIENT_HPP
+#include "timeseries.hpp"
+
+// Electromagnetic transients with fixed time step
+
+namespace utilsim
+{
+	class Transient {
+		/*	Trapezoidal companion circuits of the element branches
+			i(t) = G * (v(t) + e(t)) + H(t)
+			where:
+			G - branch conductance, R-L: 1 / (R + 2L/dt), C: 2C/dt
+			H - history term, R-L: G*(v + e) + G*(2L/dt - R)*i, C: -G*v - i, both at t - dt
+			The nodal conductance matrix depends on the step only and is factored once per step size,
+			every step is a source vector update and one forward/back substitution.
+			Its pattern, value slots and symbolic analysis follow the branch structure, a step size or
+			parametric change refills the values and refactorizes numerically.
+			Branches are rebuilt when the network changed since the last build, branch states are
+			kept while the branch structure is unchanged, otherwise the network restarts de-energized.
+		*/
+	public:
+		Transient(Network* net);
+		// Builds and factors the conductance matrix, state is kept
+		// False for a non-positive step, a series branch without impedance or a singular network
+		bool setStep(double dt);
+		// De-energized network at time zero
+		void reset();
+		// Sink receives node voltages after every step, false without a valid step
+		bool run(int steps, Sink* sink = nullptr);
+		double getTime();
+		// Conductor voltages by DOF followed by internal nodes, real parts
+		CV& getVoltages();
+	private:
+		// Branch with global node indices, -1 for ground
+		struct Companion {
+			int From;
+			int To;
+			double G;
+			// History coefficients for branch voltage and current
+			double A;
+			double B;
+			CPX E;
+			// State of the last step, branch voltage with emf and current
+			double Vb;
+			double I;
+		};
+		Network* Net;
+		// Element branches in companion order
+		vector<Branch> Branches;
+		vector<Companion> Companions;
+		int Nodes = 0;
+		// Network revision of the branches
+		int Built = -1;
+		bool Ready = false;
+		double Step = 0;
+		double Time = 0;
+		int Count = 0;
+		CSM Y;
+		CV R;
+		CV V;
+		CSLU Solver;
+		// Pattern of the current branch structure, value slots per companion and of the unused nodes
+		bool Patterned = false;
+		vector<vector<int>> Slots;
+		vector<int> Unused;
+		vector<int> UnusedSlots;
+		bool refresh();
+		void build();
+		bool factor();
+		void pattern();
+	};
+}
+
+#endif